@@ -0,0 +1,121 @@
+// Applies random weight changes, blocked cells and unblocked cells to a map and checks after every change that
+// the incrementally repaired heuristic tables equal the tables computed from scratch. Reports both runtimes.
+#include "KivaGraph.h"
+#include "SortingGraph.h"
+#include "OnlineGraph.h"
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <memory>
+#include <random>
+
+
+int main(int argc, char** argv)
+{
+	namespace po = boost::program_options;
+	po::options_description desc("Allowed options");
+	desc.add_options()
+		("help", "produce help message")
+		("scenario", po::value<string>()->required(), "scenario of the map (SORTING, KIVA, ONLINE)")
+		("map,m", po::value<string>()->required(), "input map file")
+		("rotation", po::value<bool>()->default_value(false), "consider rotation")
+		("oriented_heuristics", po::value<bool>()->default_value(false), "keep a distance per orientation")
+		("threads", po::value<int>()->default_value(1), "number of threads for computing heuristic tables")
+		("changes", po::value<int>()->default_value(50), "number of random changes")
+		("seed", po::value<int>()->default_value(0), "random seed")
+		;
+	po::variables_map vm;
+	po::store(po::parse_command_line(argc, argv, desc), vm);
+	if (vm.count("help"))
+	{
+		std::cout << desc << std::endl;
+		return 1;
+	}
+	po::notify(vm);
+
+	std::unique_ptr<BasicGraph> G;
+	if (vm["scenario"].as<string>() == "KIVA")
+		G.reset(new KivaGrid());
+	else if (vm["scenario"].as<string>() == "SORTING")
+		G.reset(new SortingGrid());
+	else if (vm["scenario"].as<string>() == "ONLINE")
+		G.reset(new OnlineGrid());
+	else
+	{
+		cout << "Scenario " << vm["scenario"].as<string>() << " does not exist!" << endl;
+		return -1;
+	}
+	G->num_threads = vm["threads"].as<int>();
+	G->oriented_heuristics = vm["oriented_heuristics"].as<bool>();
+	if (!G->load_map(vm["map"].as<string>()))
+		return -1;
+	if (vm["scenario"].as<string>() == "KIVA")
+		static_cast<KivaGrid&>(*G).preprocessing(vm["rotation"].as<bool>());
+	else if (vm["scenario"].as<string>() == "SORTING")
+		static_cast<SortingGrid&>(*G).preprocessing(vm["rotation"].as<bool>());
+	else
+		static_cast<OnlineGrid&>(*G).preprocessing(vm["rotation"].as<bool>());
+	bool per_orientation = G->consider_rotation && G->oriented_heuristics;
+
+	vector<int> cells;
+	for (int loc = 0; loc < G->size(); loc++)
+	{
+		if (!G->is_type(loc, OBSTACLE))
+			cells.push_back(loc);
+	}
+	const double weights[] = {1, 1.5, 2, 3};
+	std::mt19937 gen(vm["seed"].as<int>());
+	vector<int> blocked;
+	double repair_time = 0, recompute_time = 0;
+	int num_mismatches = 0;
+	for (int i = 0; i < vm["changes"].as<int>(); i++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		int kind = gen() % 3;
+		if (kind == 0 && !blocked.empty())
+		{
+			int j = gen() % blocked.size();
+			G->unblock_cell(blocked[j]);
+			blocked.erase(blocked.begin() + j);
+		}
+		else if (kind == 1)
+		{
+			int loc = cells[gen() % cells.size()];
+			G->block_cell(loc);
+			blocked.push_back(loc);
+		}
+		else
+		{
+			vector<WeightUpdate> updates;
+			for (int j = 0; j < 4; j++)
+			{
+				int loc = cells[gen() % cells.size()];
+				int dir = gen() % 4;
+				if (G->valid_move(loc, dir))
+					updates.push_back(WeightUpdate{loc, dir, weights[gen() % 4]});
+			}
+			G->update_weights(updates);
+		}
+		repair_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		start = std::chrono::steady_clock::now();
+		vector<double> repaired;
+		for (int root : G->heuristics.get_roots())
+		{
+			vector<double> computed = G->compute_heuristics(root, per_orientation);
+			G->heuristics.get_values(root, repaired);
+			for (size_t loc = 0; loc < computed.size(); loc++)
+			{
+				if (std::abs(repaired[loc] - computed[loc]) > 1e-9 && repaired[loc] != computed[loc])
+				{
+					if (num_mismatches++ < 10)
+						cout << "Change " << i << ": the distance from " << loc << " to " << root << " is "
+							<< repaired[loc] << " instead of " << computed[loc] << endl;
+				}
+			}
+		}
+		recompute_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+	cout << vm["changes"].as<int>() << " changes, " << G->heuristics.size() << " tables, " << num_mismatches
+		<< " mismatches; repair " << repair_time << " s, recomputation " << recompute_time << " s" << endl;
+	return num_mismatches == 0 ? 0 : 1;
+}
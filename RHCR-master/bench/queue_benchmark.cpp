@@ -0,0 +1,194 @@
+// Replays single-agent queries recorded by lifelong --record_queries=<file> with every queue policy
+// of the single-agent solver and reports the time spent in the solver. With --threads, it also replays every
+// query on several threads at once against one frozen reservation table and checks that all of them return
+// the path of the serial replay.
+#include "KivaGraph.h"
+#include "SortingGraph.h"
+#include "OnlineGraph.h"
+#include "SingleAgentSolver.h"
+#include "SearchQueue.h"
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+
+struct Query
+{
+	State start;
+	vector<pair<int, int> > goal_location;
+	std::unique_ptr<ReservationTable> rt;
+	bool prioritize_start;
+	bool hold_endpoints;
+	double suboptimal_bound;
+};
+
+
+// the solver changes the (lazily built) safe interval table, so every run gets fresh reservation tables
+bool load_queries(const string& fname, const BasicGraph& G, SingleAgentSolver& solver, vector<Query>& queries)
+{
+	std::ifstream file(fname);
+	if (!file.is_open())
+		return false;
+	queries.clear();
+	while (true)
+	{
+		Query query;
+		query.rt.reset(new ReservationTable(G));
+		if (!solver.load_query(file, query.start, query.goal_location, *query.rt))
+			break;
+		query.prioritize_start = solver.prioritize_start;
+		query.hold_endpoints = solver.hold_endpoints;
+		query.suboptimal_bound = solver.suboptimal_bound;
+		queries.push_back(std::move(query));
+	}
+	return true;
+}
+
+
+int main(int argc, char** argv)
+{
+	namespace po = boost::program_options;
+	po::options_description desc("Allowed options");
+	desc.add_options()
+		("help", "produce help message")
+		("scenario", po::value<string>()->required(), "scenario of the map (SORTING, KIVA, ONLINE)")
+		("map,m", po::value<string>()->required(), "input map file")
+		("queries,q", po::value<string>()->required(), "queries recorded by lifelong --record_queries")
+		("single_agent_solver", po::value<string>()->default_value("SIPP"), "single-agent solver (ASTAR, SIPP)")
+		("rotation", po::value<bool>()->default_value(false), "consider rotation (as in the recording run)")
+		("oriented_heuristics", po::value<bool>()->default_value(false), "as in the recording run")
+		("repeat", po::value<int>()->default_value(3), "number of runs per queue")
+		("threads", po::value<int>()->default_value(1), "number of concurrent searches per frozen query (1: none)")
+		;
+	po::variables_map vm;
+	po::store(po::parse_command_line(argc, argv, desc), vm);
+	if (vm.count("help"))
+	{
+		std::cout << desc << std::endl;
+		return 1;
+	}
+	po::notify(vm);
+
+	std::unique_ptr<BasicGraph> G;
+	if (vm["scenario"].as<string>() == "KIVA")
+		G.reset(new KivaGrid());
+	else if (vm["scenario"].as<string>() == "SORTING")
+		G.reset(new SortingGrid());
+	else if (vm["scenario"].as<string>() == "ONLINE")
+		G.reset(new OnlineGrid());
+	else
+	{
+		cout << "Scenario " << vm["scenario"].as<string>() << " does not exist!" << endl;
+		return -1;
+	}
+	if (!G->load_map(vm["map"].as<string>()))
+		return -1;
+	G->oriented_heuristics = vm["oriented_heuristics"].as<bool>();
+	if (vm["scenario"].as<string>() == "KIVA")
+		static_cast<KivaGrid&>(*G).preprocessing(vm["rotation"].as<bool>());
+	else if (vm["scenario"].as<string>() == "SORTING")
+		static_cast<SortingGrid&>(*G).preprocessing(vm["rotation"].as<bool>());
+	else
+		static_cast<OnlineGrid&>(*G).preprocessing(vm["rotation"].as<bool>());
+
+	const string queues[] = {FibonacciHeapPolicy::name, DaryHeapPolicy::name, PairingHeapPolicy::name,
+							 BucketQueuePolicy::name};
+	string solver_name = vm["single_agent_solver"].as<string>();
+	vector<Query> queries;
+	cout << "queue,queries,runtime (s),us/query,expanded,generated,sum of costs,failed" << endl;
+	for (const string& queue : queues)
+	{
+		if (queue == BucketQueuePolicy::name && !G->has_integral_weights())
+		{
+			cout << queue << ",skipped (needs integral edge weights)" << endl;
+			continue;
+		}
+		std::unique_ptr<SingleAgentSolver> solver(create_single_agent_solver(solver_name, queue));
+		if (solver == nullptr)
+		{
+			cout << "Single-agent solver " << solver_name << " does not exist!" << endl;
+			return -1;
+		}
+		double runtime = 0;
+		uint64_t num_expanded = 0, num_generated = 0;
+		double sum_of_costs = 0;
+		int num_failed = 0;
+		for (int i = 0; i < vm["repeat"].as<int>(); i++)
+		{
+			if (!load_queries(vm["queries"].as<string>(), *G, *solver, queries))
+			{
+				cout << "Query file " << vm["queries"].as<string>() << " does not exist." << endl;
+				return -1;
+			}
+			num_expanded = num_generated = 0;
+			sum_of_costs = 0;
+			num_failed = 0;
+			auto start = std::chrono::steady_clock::now();
+			for (auto& query : queries)
+			{
+				solver->prioritize_start = query.prioritize_start;
+				solver->hold_endpoints = query.hold_endpoints;
+				solver->suboptimal_bound = query.suboptimal_bound;
+				Path path = solver->run(*G, query.start, query.goal_location, *query.rt);
+				num_expanded += solver->num_expanded;
+				num_generated += solver->num_generated;
+				if (path.empty())
+					num_failed++;
+				else
+					sum_of_costs += solver->path_cost;
+			}
+			runtime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+		runtime /= vm["repeat"].as<int>();
+		cout << queue << "," << queries.size() << "," << runtime << "," << runtime * 1e6 / max((size_t)1, queries.size())
+			<< "," << num_expanded << "," << num_generated << "," << sum_of_costs << "," << num_failed << endl;
+	}
+
+	int num_threads = vm["threads"].as<int>();
+	if (num_threads <= 1)
+		return 0;
+	int num_mismatches = 0;
+	cout << "queue,threads,queries,runtime (s),mismatches" << endl;
+	for (const string& queue : queues)
+	{
+		if (queue == BucketQueuePolicy::name && !G->has_integral_weights())
+			continue;
+		vector<std::unique_ptr<SingleAgentSolver> > solvers(num_threads);
+		for (auto& solver : solvers)
+			solver.reset(create_single_agent_solver(solver_name, queue));
+		load_queries(vm["queries"].as<string>(), *G, *solvers[0], queries);
+		auto run = [&](SingleAgentSolver& solver, Query& query)
+		{
+			solver.prioritize_start = query.prioritize_start;
+			solver.hold_endpoints = query.hold_endpoints;
+			solver.suboptimal_bound = query.suboptimal_bound;
+			return solver.run(*G, query.start, query.goal_location, *query.rt);
+		};
+
+		// the serial replay builds the safe intervals lazily
+		vector<Path> expected;
+		for (auto& query : queries)
+			expected.push_back(run(*solvers[0], query));
+
+		load_queries(vm["queries"].as<string>(), *G, *solvers[0], queries);
+		int queue_mismatches = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < queries.size(); i++)
+		{
+			queries[i].rt->freeze();
+			vector<Path> paths(num_threads);
+			vector<std::thread> threads;
+			for (int j = 0; j < num_threads; j++)
+				threads.emplace_back([&, j]() { paths[j] = run(*solvers[j], queries[i]); });
+			for (auto& thread : threads)
+				thread.join();
+			for (const auto& path : paths)
+				queue_mismatches += !(path == expected[i]);
+		}
+		double runtime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		cout << queue << "," << num_threads << "," << queries.size() << "," << runtime << "," << queue_mismatches << endl;
+		num_mismatches += queue_mismatches;
+	}
+	return num_mismatches == 0 ? 0 : 1;
+}
@@ -1,23 +1,99 @@
 #pragma once
 #include "common.h"
 #include "States.h"
+#include "HeuristicTable.h"
 
 #define WEIGHT_MAX INT_MAX/2
 
+// (row, column) offsets of the four move directions and wait; move[dir] = row offset * cols + column offset
+constexpr int DIRECTION_OFFSETS[5][2] = {{0, 1}, {-1, 0}, {0, -1}, {1, 0}, {0, 0}};
+
+
+// cell types of the map; BasicGraph::types keeps the names used in the map files
+enum cell_type : uint8_t { TRAVEL, OBSTACLE, ENDPOINT, HOME, INDUCT, EJECT, MAGIC, ENTRY, EXIT, OTHER_CELL, CELL_TYPE_COUNT };
+
+cell_type get_cell_type(const string& name);
+
+// an entry of the successor/predecessor tables: the other state and the weight of the edge between them
+struct Neighbor
+{
+    int location;
+    int orientation;
+    double weight;
+};
+
+// a contiguous range of Neighbors that can be used in range-based for loops
+struct NeighborRange
+{
+    const Neighbor* first;
+    const Neighbor* last;
+    const Neighbor* begin() const { return first; }
+    const Neighbor* end() const { return last; }
+    int size() const { return (int)(last - first); }
+};
+
+
+// a new weight of the edge leaving location in direction (4 is wait, or rotate with rotation)
+struct WeightUpdate
+{
+    int location;
+    int direction;
+    double weight;
+};
+
 
 class BasicGraph
 {
 public:
-    vector<std::string> types;
-    unordered_map<int, vector<double>> heuristics;
-    virtual ~BasicGraph()= default;
+    vector<std::string> types; // cell type names, only used for I/O
+    vector<uint8_t> cell_types; // location -> cell_type
+    // root location -> distances from all locations; a cache that is filled by lookups in lazy mode,
+    // which is why it is mutable (see HeuristicTable for the threading rules of lazy mode)
+    mutable HeuristicTable heuristics;
+    virtual ~BasicGraph();
     string map_name;
 	virtual bool load_map(string fname) = 0;
-    list<State> get_neighbors(const State& v) const;
     list<int> get_neighbors(int v) const;
-    list<State> get_reverse_neighbors(const State& v) const; // ignore time
-    double get_weight(int from, int to) const; // fiducials from and to are neighbors
-    vector<vector<double> > get_weights() const {return weights; }
+
+    inline bool is_type(int loc, cell_type type) const { return (type_bitsets[type][loc >> 6] >> (loc & 63)) & 1; }
+    const vector<uint64_t>& get_cells(cell_type type) const { return type_bitsets[type]; } // bitset over locations
+    void build_cell_types(); // build cell_types and the per-type bitsets from types
+    void set_type(int loc, const string& name); // change the type of a cell after build_cell_types
+
+    // Successors (wait, move and rotate) and predecessors (move and rotate) of a state, ignoring time,
+    // in the order that the search algorithms expand them. The orientation of the state must be -1
+    // without rotation and in [0, 3] with rotation. build_neighbor_table must be called first.
+    inline NeighborRange get_successors(const State& s) const
+    {
+        int i = get_state_index(s.location, s.orientation);
+        return NeighborRange{successors.data() + successor_offsets[i], successors.data() + successor_offsets[i + 1]};
+    }
+    inline NeighborRange get_predecessors(const State& s) const
+    {
+        int i = get_state_index(s.location, s.orientation);
+        return NeighborRange{predecessors.data() + predecessor_offsets[i], predecessors.data() + predecessor_offsets[i + 1]};
+    }
+    inline int get_state_index(int location, int orientation) const
+    {
+        return consider_rotation ? location * 4 + orientation : location;
+    }
+    void build_neighbor_table(); // build the successor and predecessor tables from weights and consider_rotation
+    inline double get_weight(int from, int to) const // from and to must be neighbors
+    {
+        int dir = get_direction(from, to);
+        return dir >= 0 ? weights[dir * size() + from] : WEIGHT_MAX;
+    }
+    inline double get_weight_in_direction(int loc, int dir) const { return weights[dir * size() + loc]; } // dir 4 is wait
+    void set_weight(int loc, int dir, double weight) { weights[dir * size() + loc] = weight; }
+    const vector<double>& get_weights() const {return weights; }
+
+    // Change the graph at runtime; the cached heuristic tables are repaired incrementally.
+    // A blocked cell cannot be entered but can still be left (e.g., by a robot that broke down on it);
+    // updates of edges into a blocked cell take effect when it is unblocked.
+    void update_weights(const vector<WeightUpdate>& updates);
+    void block_cell(int loc);
+    void unblock_cell(int loc);
+    bool is_blocked(int loc) const { return blocked_cells.count(loc) > 0; }
     int get_rotate_degree(int dir1, int dir2) const; // return 0 if it is 0; return 1 if it is +-90; return 2 if it is 180
 
     void print_map() const;
@@ -25,18 +101,50 @@ public:
     int get_cols() const { return cols; }
     int size() const { return rows * cols; }
 
-    bool valid_move(int loc, int dir) const {return (weights[loc][dir] < WEIGHT_MAX - 1); }
+    bool valid_move(int loc, int dir) const {return (weights[dir * size() + loc] < WEIGHT_MAX - 1); }
+    bool has_integral_weights() const; // every move, wait and rotation costs a whole number
     int get_Manhattan_distance(int loc1, int loc2) const;
     int move[4];
     void copy(const BasicGraph& copy);
-    int get_direction(int from, int to) const;
+    inline int get_direction(int from, int to) const // -1 if from and to are not neighbors
+    {
+        int diff = to - from;
+        return (diff < -cols || diff > cols) ? -1 : direction_of[diff + cols];
+    }
+    void init_weights(); // set move and the direction lookup for the current rows and cols, and block all edges
 
-	vector<double> compute_heuristics(int root_location); // compute distances from all lacations to the root location
-	bool load_heuristics_table(std::ifstream& myfile);
-	void save_heuristics_table(string fname);
+	// compute distances from all lacations (or all (location, orientation) states) to the root location
+	vector<double> compute_heuristics(int root_location, bool per_orientation = false) const;
+	void compute_heuristics_table(const vector<int>& roots); // compute the tables of all roots in parallel
+	void build_heuristics_table(const vector<int>& roots); // load the table from file, or compute and save it
+	bool load_heuristics_table(const string& fname); // binary table, memory-mapped
+	bool save_heuristics_table(const string& fname) const; // binary table, replaced atomically
+	bool load_text_heuristics_table(std::ifstream& myfile); // legacy comma-separated table
+	bool convert_heuristics_table(const string& text_fname, const string& binary_fname);
+	uint64_t get_map_hash() const; // identifies the weighted grid that a heuristics table belongs to
+	int num_threads = 1; // number of threads used for computing heuristic tables
+	bool oriented_heuristics = false; // with rotation, keep a distance per (location, orientation) instead of per location
+	bool lazy_heuristics = false; // compute the heuristic tables on first use instead of in preprocessing
+	double heuristics_memory = 1024; // memory budget (MB) of the lazily computed tables
+	bool prefetch_heuristics = false; // compute the tables of upcoming goals on a background thread
 
     int rows;
     int cols;
-    vector<vector<double> > weights; // (directed) weighted 4-neighbor grid
     bool consider_rotation;
+
+private:
+    // (directed) weighted 4-neighbor grid, stored direction-major: weights[dir * size() + loc]
+    vector<double> weights;
+    vector<int8_t> direction_of; // to - from + cols -> direction, or -1
+    vector<vector<uint64_t> > type_bitsets; // cell_type -> bitset over locations
+    unordered_map<int, vector<double> > blocked_cells; // blocked location -> weights of the 4 edges into it
+
+    void apply_weight_updates(const vector<WeightUpdate>& updates);
+    void repair_heuristics(const vector<int>& changed_locations);
+
+    // CSR tables: the neighbors of state i are stored in [offsets[i], offsets[i + 1])
+    vector<int> successor_offsets;
+    vector<Neighbor> successors;
+    vector<int> predecessor_offsets;
+    vector<Neighbor> predecessors;
 };
@@ -15,6 +15,7 @@ public:
 	MAPFSolver& solver;
 	bool hold_endpoints;
 	bool useDummyPaths;
+	bool warm_start = false; // warm-start the low-level searches of PBS and ECBS from the previous plans
     int time_limit;
     int travel_time_window;
     int screen;
@@ -80,6 +81,8 @@ public:
 protected:
 	bool solve_by_WHCA(vector<Path>& planned_paths,
 		const vector<State>& new_starts, const vector< vector<pair<int, int> > >& new_goal_locations);
+	// after the solver failed, move the agents along its (colliding) paths as far as LRA* can resolve the conflicts
+	void resolve_conflicts_by_LRA(LRAStar& lra, vector<Path> paths);
     bool LRA_called = false;
 
 private:
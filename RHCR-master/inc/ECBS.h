@@ -57,8 +57,6 @@ private:
     std::vector<double> path_min_costs;
     std::vector<double> path_costs;
 
-    std::clock_t start;
-
     double min_f_val;
     double focal_threshold;
 
@@ -0,0 +1,47 @@
+#pragma once
+#include "BasicGraph.h"
+
+
+// Backward single-source shortest-path search over the (location, orientation) states of a grid.
+// It computes the heuristic tables without allocating search nodes: distances live in a flat array
+// indexed by location * num_orientations + orientation, and the open list is chosen from the edge weights:
+// a FIFO queue if every weight is 1 (BFS), a bucket queue if every weight is a small integer (Dial's algorithm),
+// and a binary heap otherwise.
+// An instance keeps its buffers between runs and is not thread-safe; use one instance per thread.
+class HeuristicSearch
+{
+public:
+    uint64_t num_expanded = 0;
+
+    // Compute distances from all locations to the root location. With per_orientation (and rotation),
+    // return the distance of every (location, orientation) state at location * 4 + orientation instead.
+    vector<double> run(int root_location, bool per_orientation = false);
+
+    // Update the distances to the root location (as returned by run, per state) after the weights of
+    // edges leaving changed_locations have changed and the neighbor tables have been rebuilt.
+    // Only the states whose distances change are expanded (DynamicSWSF-FP, i.e., LPA* without a heuristic).
+    // With rotation, the distances must be per orientation.
+    void repair(vector<double>& values, int root_location, const vector<int>& changed_locations);
+
+    explicit HeuristicSearch(const BasicGraph& G);
+
+private:
+    enum queue_type { FIFO, BUCKET, HEAP };
+
+    const BasicGraph& G;
+    queue_type queue;
+    int num_orientations; // 1 without rotation, 4 with rotation
+    int max_weight; // the largest edge weight (used by the bucket queue)
+
+    vector<double> dist; // state -> distance to the root
+    vector<int> fifo;
+    vector<vector<int> > buckets; // buckets[d % (max_weight + 1)] holds the states with distance d
+    vector<pair<double, int> > heap; // <distance, state>, with lazy deletion
+
+    void push(int state, double d, size_t& num_queued);
+    double get_lookahead(const vector<double>& values, int state) const; // min over successors of weight + distance
+
+    // calls relax(predecessor state, edge weight) for every state that can move to the given state
+    template<class Relax>
+    void for_each_predecessor(int state, Relax relax) const;
+};
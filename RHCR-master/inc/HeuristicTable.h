@@ -0,0 +1,243 @@
+#pragma once
+#include "common.h"
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <type_traits>
+
+
+// Distances from every location to a set of root (goal) locations, stored as one contiguous row-major matrix.
+// Roots are remapped to dense row indices, so a lookup is two array loads instead of a hash lookup.
+// Values are stored as uint16_t while every distance is a small integer, as float while every distance is
+// exactly representable by a float, and as double otherwise; inserting a row that does not fit widens the matrix.
+// With 4 orientations, a row holds the distance of every (location, orientation) state at location * 4 + orientation.
+// A table loaded from a binary file reads the values of the file in place (mapped) until a row is inserted.
+// A search can dispatch on the value type once and then read the rows of its goals through get_row_values.
+// In lazy mode, the table is a cache: a missing row is computed on first use, rows can be prefetched on a
+// background thread, and the least recently used rows are evicted to stay within a memory budget.
+// A lookup in lazy mode can change the table, so lazy lookups must all come from one thread; only the
+// prefetching thread runs alongside it, and it never touches the rows.
+class HeuristicTable
+{
+public:
+    enum value_type { UINT16, FLOAT, DOUBLE };
+
+    uint64_t num_hits = 0; // lazy mode only
+    uint64_t num_misses = 0; // rows computed by the calling thread
+    uint64_t num_prefetch_hits = 0; // rows computed by the background thread
+    uint64_t num_evictions = 0;
+
+    void set_num_orientations(int num_orientations); // 1 or 4; clears the table
+    // clears the table; compute_row returns the row of a root
+    void set_lazy(int num_locations, std::function<vector<double>(int)> compute_row,
+                  size_t memory_budget, bool prefetching);
+    bool is_lazy() const { return lazy; }
+    void prefetch(int root); // compute the row of root on the background thread (only if prefetching)
+    void cancel_prefetching(); // drop the pending and prefetched rows, e.g., before the graph changes
+    // Cancel prefetching and join the background thread. The owner of the data that compute_row reads must call
+    // it before that data is destroyed.
+    void stop_prefetching();
+    void print_cache_stats() const;
+    int get_num_orientations() const { return num_orientations; }
+
+    // clears the table and looks up the rows of roots in values of the given type, which stay valid as long as
+    // mapping is held
+    void map(const vector<int>& roots, const void* values, value_type type, int row_size,
+             std::shared_ptr<const void> mapping);
+    bool is_mapped() const { return mapped_values != nullptr; }
+    void insert(int root, const double* values, int num_values); // add or overwrite the row of root
+    void insert(int root, const vector<double>& values) { insert(root, values.data(), (int)values.size()); }
+    void clear();
+    void shrink_to_fit(); // release the capacity left over from inserting rows one by one
+
+    bool contains(int root) const { return root >= 0 && root < (int)row_of.size() && row_of[root] >= 0; }
+    size_t size() const { return roots.size(); } // number of roots
+    const vector<int>& get_roots() const { return roots; } // in row order
+
+    // distance from loc to root (DBL_MAX if unreachable); throws std::out_of_range if root has no row.
+    // Without an orientation, it is the smallest distance over the orientations of loc.
+    inline double get(int root, int loc) { return get_by_row(get_row(root), loc); }
+    inline double get(int root, int loc, int orientation) { return get_by_row(get_row(root), loc, orientation); }
+    // In lazy mode, the row index is only valid until the next lookup: a miss can evict the row, or move the
+    // last row into an evicted one, so the index must not be kept across lookups.
+    inline int get_row(int root)
+    {
+        if (contains(root))
+        {
+            if (lazy)
+            {
+                touch(row_of[root]);
+                num_hits++;
+            }
+            return row_of[root];
+        }
+        if (lazy)
+            return load_row(root);
+        throw std::out_of_range("no heuristics for location " + std::to_string(root));
+    }
+    inline double get_by_row(int row, int loc, int orientation = -1) const
+    {
+        switch (type)
+        {
+        case UINT16:
+            return get_from_row(get_row_values<uint16_t>(row), num_orientations, loc, orientation);
+        case FLOAT:
+            return get_from_row(get_row_values<float>(row), num_orientations, loc, orientation);
+        default:
+            return get_from_row(get_row_values<double>(row), num_orientations, loc, orientation);
+        }
+    }
+    // Loads the rows of roots (in lazy mode, without evicting each other, even beyond the memory budget) and
+    // sets rows to their row indices, which stay valid until the next lookup of a root without a row.
+    void get_rows(const vector<int>& roots, vector<int>& rows);
+    void get_values(int root, vector<double>& values) const; // copy the row of root as doubles
+
+    // The values of a row as an array of Value, which must be the value type of the table. The array stays valid
+    // until the table changes (in lazy mode, until the next lookup of a root without a row).
+    template<class Value>
+    inline const Value* get_row_values(int row) const { return get_data<Value>() + (size_t)row * row_size; }
+    // the distance from loc to the root of a row given by get_row_values, as get_by_row
+    template<class Value>
+    static inline double get_from_row(const Value* values, int num_orientations, int loc, int orientation = -1)
+    {
+        if (orientation >= 0 && num_orientations > 1)
+            return decode(values[loc * num_orientations + orientation]);
+        const Value* h = values + loc * num_orientations;
+        double h_min = decode(h[0]);
+        for (int o = 1; o < num_orientations; o++)
+            h_min = std::min(h_min, decode(h[o]));
+        return h_min;
+    }
+
+    // conversions between distances (DBL_MAX if unreachable) and stored values
+    template<class Value>
+    static inline Value encode(double value)
+    {
+        if constexpr (std::is_same<Value, uint16_t>::value)
+            return value == DBL_MAX ? UINT16_UNREACHABLE : (uint16_t)value;
+        else if constexpr (std::is_same<Value, float>::value)
+            return value == DBL_MAX ? FLOAT_UNREACHABLE : (float)value;
+        else
+            return value;
+    }
+    static inline double decode(uint16_t value) { return value == UINT16_UNREACHABLE ? DBL_MAX : value; }
+    static inline double decode(float value) { return value == FLOAT_UNREACHABLE ? DBL_MAX : value; }
+    static inline double decode(double value) { return value; }
+
+    value_type get_value_type() const { return type; }
+    value_type get_smallest_type() const; // the smallest value type that holds every distance of the table
+    static size_t get_value_size(value_type type)
+    {
+        return type == UINT16 ? sizeof(uint16_t) : (type == FLOAT ? sizeof(float) : sizeof(double));
+    }
+    size_t get_memory_usage() const; // in bytes
+
+    HeuristicTable() = default;
+    HeuristicTable(const HeuristicTable&) = delete;
+    HeuristicTable& operator=(const HeuristicTable&) = delete;
+    ~HeuristicTable();
+
+private:
+    static const uint16_t UINT16_UNREACHABLE = UINT16_MAX;
+    static constexpr float FLOAT_UNREACHABLE = std::numeric_limits<float>::infinity();
+
+    int num_orientations = 1;
+    int num_locations = 0;
+    int row_size = 0; // num_locations * num_orientations
+    vector<int> row_of; // location -> row index, -1 if the location is not a root
+    vector<int> roots; // row index -> location
+    value_type type = UINT16;
+    vector<uint16_t> u16_values;
+    vector<float> f32_values;
+    vector<double> f64_values;
+    const void* mapped_values = nullptr; // of the value type
+    std::shared_ptr<const void> mapping; // keeps mapped_values valid
+
+    // lazy mode
+    bool lazy = false;
+    std::function<vector<double>(int)> compute_row;
+    size_t memory_budget = 0; // for the values, in bytes
+    // rows in the order of their last lookup, as a doubly linked list over the row indices
+    vector<int> lru_prev; // row index -> the row looked up just after it, or -1
+    vector<int> lru_next; // row index -> the row looked up just before it, or -1
+    int lru_head = -1; // the most recently used row
+    int lru_tail = -1; // the least recently used row
+    inline void lru_unlink(int row)
+    {
+        (lru_prev[row] >= 0 ? lru_next[lru_prev[row]] : lru_head) = lru_next[row];
+        (lru_next[row] >= 0 ? lru_prev[lru_next[row]] : lru_tail) = lru_prev[row];
+    }
+    inline void lru_push_front(int row)
+    {
+        lru_prev[row] = -1;
+        lru_next[row] = lru_head;
+        (lru_head >= 0 ? lru_prev[lru_head] : lru_tail) = row;
+        lru_head = row;
+    }
+    inline void touch(int row)
+    {
+        if (row != lru_head)
+        {
+            lru_unlink(row);
+            lru_push_front(row);
+        }
+    }
+
+    // prefetching; everything below is guarded by mutex
+    std::thread prefetcher;
+    std::mutex mutex;
+    std::condition_variable requested;
+    std::condition_variable computed;
+    deque<int> requests;
+    unordered_set<int> queued; // roots in requests or being computed
+    int computing = -1; // the root that the background thread is working on
+    unordered_map<int, vector<double> > prefetched; // rows waiting to be inserted
+    bool stopping = false;
+
+    size_t num_pinned = 0; // the most recently used rows, which cannot be evicted (see get_rows)
+    int load_row(int root); // compute (or take the prefetched) row of root and insert it
+    bool take_prefetched(int root, vector<double>& values);
+    void run_prefetcher();
+    size_t get_max_rows() const;
+    void evict_row(int row);
+    template<class Value>
+    inline vector<Value>& get_storage()
+    {
+        if constexpr (std::is_same<Value, uint16_t>::value)
+            return u16_values;
+        else if constexpr (std::is_same<Value, float>::value)
+            return f32_values;
+        else
+            return f64_values;
+    }
+    template<class Value>
+    inline const Value* get_data() const
+    {
+        if (mapped_values != nullptr)
+            return static_cast<const Value*>(mapped_values);
+        return const_cast<HeuristicTable*>(this)->get_storage<Value>().data();
+    }
+    inline double get_value(size_t idx) const
+    {
+        switch (type)
+        {
+        case UINT16:
+            return decode(get_data<uint16_t>()[idx]);
+        case FLOAT:
+            return decode(get_data<float>()[idx]);
+        default:
+            return decode(get_data<double>()[idx]);
+        }
+    }
+    static value_type get_required_type(const double* values, int num_values);
+    void widen(value_type new_type);
+    void materialize(); // copy the mapped values, so that rows can be inserted
+    template<class Value>
+    void materialize_as();
+};
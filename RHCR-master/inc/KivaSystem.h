@@ -39,6 +39,7 @@ private:
  
     void initialize_goal_locations(int capacity);
     void update_goal_locations(int capacity);
+    void prefetch_zone_tasks(int num_tasks) const; // heuristics of the next tasks in every zone queue
 
  
     std::vector<int> queue_to_vector(int zone) const;  
@@ -9,6 +9,8 @@ class MAPFSolver
 public:
     int k_robust;
     int window;
+	// the timesteps of a solution that are executed before the next replanning, which a partial path must cover
+	int commit_window = INT_MAX;
 	bool hold_endpoints;
 
 	double runtime;
@@ -22,7 +24,7 @@ public:
 
 	// initial data
 	ReservationTable initial_rt;
-	vector<Path> initial_paths;
+	vector<Path> initial_paths; // agent -> its previous plan (may be empty) that warm-starts its low-level searches
     list< tuple<int, int, int> > initial_constraints; // <agent, location, timestep>:
     // only this agent can stay in this location before this timestep.
 	list<const Path*> initial_soft_path_constraints; // the paths that all agents try to avoid
@@ -52,6 +54,7 @@ public:
     vector< vector<pair<int, int> > > goal_locations;
     int num_of_agents;
 	int time_limit;
+	bool low_level_deadline = false; // bound each low-level search by the time left before time_limit
 
     // validate
     bool validate_solution();
@@ -60,5 +63,21 @@ protected:
     vector<vector<bool> > cat; // conflict avoidance table
     vector<unordered_set< pair<int, int> > > constraint_table;
     ReservationTable rt;
+    std::clock_t start = 0;
+
+	// Plan the path of the agent against rt, warm-started from its initial path if any. When the search runs
+	// out of its budget, its partial path is returned if keep_partial_path accepts it, and an empty path
+	// (a failure) otherwise.
+	Path plan_path(int agent);
+	bool low_level_partial = false; // whether the last plan_path returned a partial path
+	bool low_level_out_of_budget = false; // whether the last plan_path failed because of its budget
+	// A partial path is conflict-free with respect to the reservation table up to its end, so it can stand in
+	// for the full path if it covers the committed part of the solution (and the planning window, beyond which
+	// only the committed part matters). With held endpoints, the end of a path is held forever, so a partial
+	// path is never kept.
+	inline bool keep_partial_path(const Path& path) const
+	{
+		return !hold_endpoints && !path.empty() && path.back().timestep >= min(commit_window, window);
+	}
 };
 
@@ -0,0 +1,67 @@
+#pragma once
+#include "common.h"
+#include <type_traits>
+
+
+// Owns the search nodes of a single-agent solver. Nodes are constructed in place in fixed-size blocks
+// that are kept between runs, so creating a node bumps an index and releasing all nodes of a run is O(1).
+// Once the blocks cover the largest search so far, the solver stops calling malloc for nodes.
+// Pointers to nodes stay valid until reset.
+template<class Node>
+class NodePool
+{
+public:
+    uint64_t num_nodes = 0; // nodes created over all runs
+    uint64_t num_blocks = 0; // blocks allocated, i.e., the heap allocations of the pool
+    uint64_t num_resets = 0;
+
+    template<class... Args>
+    Node* create(Args&&... args)
+    {
+        if (used == blocks.size() * BLOCK_SIZE)
+        {
+            blocks.push_back(static_cast<Node*>(::operator new(BLOCK_SIZE * sizeof(Node))));
+            num_blocks++;
+        }
+        Node* node = new (blocks[used / BLOCK_SIZE] + used % BLOCK_SIZE) Node(std::forward<Args>(args)...);
+        used++;
+        num_nodes++;
+        return node;
+    }
+
+    void reset() // destroy all nodes but keep their memory
+    {
+        if (!std::is_trivially_destructible<Node>::value)
+        {
+            for (size_t i = 0; i < used; i++)
+                (blocks[i / BLOCK_SIZE] + i % BLOCK_SIZE)->~Node();
+        }
+        used = 0;
+        num_resets++;
+    }
+
+    size_t size() const { return used; }
+    size_t capacity() const { return blocks.size() * BLOCK_SIZE; }
+
+    void print_stats(const string& name) const
+    {
+        std::cout << name << " nodes: " << num_nodes << " created in " << num_resets << " runs, "
+            << num_blocks << " blocks allocated (" << capacity() * sizeof(Node) / 1048576.0 << " MB)" << std::endl;
+    }
+
+    NodePool() = default;
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+    ~NodePool()
+    {
+        reset();
+        for (Node* block : blocks)
+            ::operator delete(block);
+    }
+
+private:
+    static const size_t BLOCK_SIZE = 1024;
+
+    vector<Node*> blocks;
+    size_t used = 0;
+};
@@ -0,0 +1,117 @@
+#pragma once
+#include "common.h"
+#include <cstdint>
+#include <stdexcept>
+
+
+// Packs the fields that identify a search node into a 64-bit key: the location (24 bits), the time (27 bits),
+// the goal id (10 bits), and the orientation (3 bits). The time is the timestep for A* and the start of the
+// safe interval for SIPP. Fields out of range would make distinct nodes share a key, so they throw
+// std::overflow_error (in release builds too).
+inline uint64_t pack_node_key(int location, int orientation, int time, int goal_id)
+{
+    if ((uint32_t)location >= (1u << 24) || (uint32_t)(orientation + 1) >= 8 ||
+        (uint32_t)time >= (1u << 27) || (uint32_t)goal_id >= (1u << 10))
+        throw std::overflow_error("search node (location " + std::to_string(location) + ", time " +
+            std::to_string(time) + ", goal id " + std::to_string(goal_id) + ") does not fit in a node key");
+    return ((uint64_t)location << 40) | ((uint64_t)time << 13) |
+        ((uint64_t)goal_id << 3) | (uint64_t)(orientation + 1);
+}
+
+
+// Open-addressing hash table (linear probing) from node keys to the nodes of a single-agent search.
+// Node::get_key() returns the packed key of a node. The slots store the keys next to the node pointers,
+// so probing does not touch the nodes. Clearing bumps a generation counter instead of touching the slots,
+// and the slots are kept between runs, so the next run starts with the size of the largest run so far.
+// A node whose key changes (e.g., its goal id) is inserted again; the slot with its old key goes stale.
+template<class Node>
+class NodeTable
+{
+public:
+    Node* find(uint64_t key) const
+    {
+        if (slots.empty())
+            return nullptr;
+        for (size_t i = hash(key) & mask; slots[i].generation == generation; i = (i + 1) & mask)
+        {
+            if (slots[i].key == key && slots[i].node->get_key() == key)
+                return slots[i].node;
+        }
+        return nullptr;
+    }
+
+    // does nothing if another node already has the same key
+    void insert(Node* node)
+    {
+        if ((used + 1) * 2 > slots.size())
+            rehash(max((size_t)MIN_CAPACITY, slots.size() * 2));
+        uint64_t key = node->get_key();
+        size_t i = hash(key) & mask;
+        for (; slots[i].generation == generation; i = (i + 1) & mask)
+        {
+            if (slots[i].key == key)
+            {
+                if (slots[i].node->get_key() != key) // stale
+                    slots[i].node = node;
+                return;
+            }
+        }
+        slots[i] = Slot{key, node, generation};
+        used++;
+    }
+
+    void clear()
+    {
+        used = 0;
+        if (++generation == 0) // wrapped around, so old slots could look current
+        {
+            for (auto& slot : slots)
+                slot.generation = 0;
+            generation = 1;
+        }
+    }
+
+    size_t size() const { return used; } // including stale slots
+    size_t capacity() const { return slots.size(); }
+
+private:
+    static const size_t MIN_CAPACITY = 1024;
+
+    struct Slot
+    {
+        uint64_t key;
+        Node* node;
+        uint32_t generation; // the slot is empty unless it equals the generation of the table
+    };
+    vector<Slot> slots;
+    size_t mask = 0;
+    size_t used = 0;
+    uint32_t generation = 1;
+
+    static size_t hash(uint64_t key) // the finalizer of splitmix64
+    {
+        key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        key = (key ^ (key >> 27)) * 0x94d049bb133111ebULL;
+        return (size_t)(key ^ (key >> 31));
+    }
+
+    void rehash(size_t capacity)
+    {
+        vector<Slot> old_slots(capacity, Slot{0, nullptr, 0});
+        old_slots.swap(slots);
+        mask = capacity - 1;
+        uint32_t old_generation = generation;
+        generation = 1;
+        used = 0;
+        for (const auto& slot : old_slots)
+        {
+            if (slot.generation != old_generation || slot.node->get_key() != slot.key)
+                continue;
+            size_t i = hash(slot.key) & mask;
+            while (slots[i].generation == generation)
+                i = (i + 1) & mask;
+            slots[i] = Slot{slot.key, slot.node, generation};
+            used++;
+        }
+    }
+};
@@ -59,21 +59,28 @@ public:
 
 private:
 
-    std::vector< Path* > paths;
+    std::vector< Path* > paths; // change them with set_path to keep rt up to date
     list<PBSNode*> allNodes_table;
     list<PBSNode*> dfs;
 
    //  vector<State> starts;
     // vector< vector<int> > goal_locations;
 
-    std::clock_t start = 0;
-
 	// double focal_w = 1.0;
     unordered_set<pair<int, int>> nogood;
 
     // SingleAgentICBS astar;
 
 
+    inline void set_path(int agent, Path* path)
+    {
+        if (paths[agent] != path)
+        {
+            rt.removePath(agent);
+            paths[agent] = path;
+        }
+    }
+
     bool generate_root_node();
     void push_node(PBSNode* node);
     PBSNode* pop_node();
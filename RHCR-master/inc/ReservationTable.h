@@ -1,6 +1,7 @@
 #pragma once
 #include "States.h"
 #include "BasicGraph.h"
+#include <stdexcept>
 
 class ReservationTable
 {
@@ -15,8 +16,11 @@ public:
     bool prioritize_start;
     double runtime;
 
-    void clear() {sit.clear(); ct.clear(); cat.clear(); }
-	void copy(const ReservationTable& other) {sit = other.sit; ct = other.ct; cat = other.cat; }
+    void clear(); // reset only the slots that are in use
+	void copy(const ReservationTable& other); // deep copy
+	// Make this table an empty overlay on top of base in O(1): lookups consult both layers, and everything
+	// inserted goes to the overlay. base must not change, nor be searched on, until this table is cleared.
+	void setBase(const ReservationTable& base);
     void build(const vector<Path*>& paths,
                const list< tuple<int, int, int> >& initial_constraints,
                const unordered_set<int>& high_priority_agents, int current_agent, int start_location);
@@ -26,9 +30,28 @@ public:
     void build(const vector<Path*>& paths,
                const list< tuple<int, int, int> >& initial_constraints,
                const list< Constraint >& constraints, int current_agent);
+	// For PBS: keep the table between the low-level searches and only update what has changed. Every agent
+	// holds references to the time ranges that its path, its start reservation (with prioritize_start) and
+	// its initial constraints inserted into CT, so they can be removed without rebuilding the table.
+	void update(const vector<Path*>& paths,
+			const list< tuple<int, int, int> >& initial_constraints,
+			const unordered_set<int>& high_priority_agents, int current_agent);
+	void addPath(int agent, const Path& path); // insert the path of the agent as hard constraints
+	void removePath(int agent); // must be called whenever the path of the agent changes
 	void insertPath2CT(const Path& path); // insert the path to the constraint table
 	void print() const;
     void printCT(size_t location) const;
+	void save(ostream& os) const; // parameters and tables as text, for replaying single-agent queries
+	bool load(std::istream& is);
+
+	// Build the SIT of every location and edge with constraints or conflicts up front, so that the SIPP
+	// functions below no longer write to the table and several searches can run on it concurrently.
+	// Changing a frozen table throws std::logic_error until unfreeze() or clear() is called, and its base
+	// must not change while it is frozen. The searches also share the heuristic tables of the graph, which
+	// are only read-only when they are not lazy, so freeze throws std::logic_error with lazy heuristics.
+	void freeze();
+	void unfreeze() { frozen = false; }
+	bool is_frozen() const { return frozen; }
 
     // functions  for SIPP
     list<Interval> getSafeIntervals(int location, int lower_bound, int upper_bound);
@@ -43,18 +66,81 @@ public:
 	int getHoldingTimeFromCT(int location) const;
     set<int> getConstrainedTimesteps(int location) const;
 
+	// the last timestep at which a move is constrained or conflicting, or INT_MAX if a location is reserved forever
+	int getLastConstrainedTimestep() const;
+
 	ReservationTable(const BasicGraph& G): G(G) {}
 private:
 	const BasicGraph& G;
-	// Constraint Table (CT)
-	unordered_map<size_t, list<pair<int, int> > > ct; // location/edge -> time range
-	// Conflict Avoidance Table (CAT)
-	vector<vector<bool> > cat; //  (timestep, location) ->  have conflicts or not
-	// Safe Interval Table (SIT)
-	unordered_map<size_t, list<Interval > > sit; // location/edge -> [t_min, t_max), num_of_collisions
+
+	// The constraints and safe intervals of a location or an edge. Slots are indexed densely: slot loc is
+	// location loc, and slot (dir + 1) * map_size + from is the edge leaving from in direction dir
+	// (4 is wait). Slots keep their memory across clear() so that rebuilding the table does not allocate.
+	struct Slot
+	{
+		vector<pair<int, int> > ct; // Constraint Table (CT): time ranges [t_min, t_max), sorted by t_min
+		vector<Interval> sit; // Safe Interval Table (SIT): [t_min, t_max), have conflicts or not
+		bool sit_built = false; // sit is built lazily from ct and cat by updateSIT
+		bool dirty = false; // in dirty_slots
+	};
+	vector<Slot> slots; // 6 * map_size slots, allocated on first use
+	const ReservationTable* base = nullptr; // the layer below, which has no base itself
+	bool frozen = false; // every SIT that differs from the default one is built
+	inline void checkWritable() const
+	{
+		if (frozen)
+			throw std::logic_error("the reservation table is frozen");
+	}
+	vector<size_t> dirty_slots; // slots that are not empty
+	// Conflict Avoidance Table (CAT): location-major bitsets over the timesteps [0, cat_size), i.e.,
+	// whether location loc has conflicts at timestep t is bit t % 64 of cat[loc * cat_words + t / 64]
+	vector<uint64_t> cat;
+	int cat_size = 0;
+	int cat_words = 0;
+	inline bool getCAT(int location, int t) const
+	{
+		return (cat[location * cat_words + (t >> 6)] >> (t & 63)) & 1;
+	}
+	void setCAT(int location, int t_min, int t_max); // set [t_min, t_max) of the location
+	void resizeCAT(int size);
+
+	// references of update, indexed by owner: the path (agent), the start reservation (num_of_agents + agent)
+	// and the initial constraints (2 * num_of_agents + agent) of an agent, and the initial constraints of
+	// no agent (3 * num_of_agents)
+	enum ReferenceState : uint8_t { UNKNOWN, OUT_OF_CT, IN_CT };
+	struct Reference
+	{
+		size_t slot;
+		int t_min;
+		int t_max;
+	};
+	vector<vector<Reference> > references;
+	vector<ReferenceState> reference_states;
+	vector<int> path_agents; // agents whose paths are in CT
+	int excluded_agent = -1; // the agent whose start reservation and initial constraints are out of CT
+	vector<Reference>* recording = nullptr; // insertCT records the time ranges to it
+	void insertReferences(int owner);
+	void eraseReferences(int owner);
+	void insertConstraints4start(const Path& path); // the start reservation of a path
+
+	inline const Slot* findSlot(size_t index) const
+	{
+		return index < slots.size() && slots[index].dirty ? &slots[index] : nullptr;
+	}
+	inline const Slot* findBaseSlot(size_t index) const
+	{
+		return base == nullptr ? nullptr : base->findSlot(index);
+	}
+	void copySlots(const ReservationTable& other); // add the CT and SIT of the slots of other (but not of its base)
+	void allocateSlots();
+	Slot& getSlot(size_t index); // marks the slot dirty
+	void insertCT(size_t index, int t_min, int t_max); // insert a time range to the CT of a slot
+	void eraseCT(size_t index, int t_min, int t_max); // erase one copy of a time range from the CT of a slot
+	inline void resetSIT(Slot& slot) { slot.sit.clear(); slot.sit_built = false; }
 
 	void updateSIT(size_t location); // update SIT at the gvien location
-	void mergeIntervals(list<Interval >& intervals) const; //merge successive safe intervals with the same number of conflicts.
+	const vector<Interval>& getSIT(size_t location); // read-only once the table is frozen
+	void mergeIntervals(vector<Interval >& intervals) const; //merge successive safe intervals with the same number of conflicts.
 
 
 
@@ -63,7 +149,21 @@ private:
     void insertConstraints4starts(const vector<Path*>& paths, int current_agent, int start_location);	
 	void insertPath2CAT(const Path& path); //  insert the path to the conflict avoidance table
 	void addInitialConstraints(const list< tuple<int, int, int> >& initial_constraints, int current_agent);
-	inline int getEdgeIndex(int from, int to) const {return (from + 1) * map_size + to; }
-	inline pair<int, int> getEdge(int index) const {return make_pair(index / map_size - 1, index % map_size); }
+	// the slot of the edge between two neighboring (or identical) locations
+	inline size_t getEdgeIndex(int from, int to) const
+	{
+		int dir = G.get_direction(from, to);
+		if (dir < 0) // the slot would be the vertex slot of from
+			throw std::invalid_argument("no edge between locations " + std::to_string(from) + " and " + std::to_string(to));
+		return (dir + 1) * map_size + from;
+	}
+	inline pair<int, int> getEdge(size_t index) const
+	{
+		int from = (int)(index % map_size), dir = (int)(index / map_size) - 1;
+		return make_pair(from, dir < 4 ? from + G.move[dir] : from);
+	}
+	// the key of a slot in the files of save and load: location, or (from + 1) * map_size + to for edges
+	size_t getSlotKey(size_t index) const;
+	size_t getSlotIndex(size_t key) const;
 
 };
\ No newline at end of file
@@ -1,20 +1,24 @@
 #pragma once
 #include "StateTimeAStar.h"
 #include "SingleAgentSolver.h"
-// TODO: make SIPP work with edge-weighted graphs
 
 
-class SIPPNode: public StateTimeAStarNode
+template<class QueuePolicy>
+class SIPPNodeT: public StateTimeAStarNodeT<QueuePolicy>
 {
 public:
-	SIPPNode* parent;
+	SIPPNodeT* parent;
     Interval interval;
+    // The other nodes in the same safe interval that arrive at different timesteps. With non-unit wait costs,
+    // an earlier arrival does not always have a smaller g-val, so a safe interval can hold several nodes.
+    // The list can pass through nodes with other keys (whose goal ids have changed since they were linked).
+    SIPPNodeT* next_arrival;
 
     // the following is used to comapre nodes in the OPEN list
     struct compare_node
     {
         // returns true if n1 > n2 (note -- this gives us *min*-heap).
-        bool operator()(const SIPPNode* n1, const SIPPNode* n2) const
+        bool operator()(const SIPPNodeT* n1, const SIPPNodeT* n2) const
         {
             if (n1->g_val + n1->h_val == n2->g_val + n2->h_val)
                 return n1->g_val <= n2->g_val;  // break ties towards larger g_vals
@@ -25,7 +29,7 @@ public:
     // the following is used to comapre nodes in the FOCAL list
     struct secondary_compare_node
     {
-        bool operator()(const SIPPNode* n1, const SIPPNode* n2) const // returns true if n1 > n2
+        bool operator()(const SIPPNodeT* n1, const SIPPNodeT* n2) const // returns true if n1 > n2
         {
             if (n1->conflicts == n2->conflicts)
             {
@@ -39,68 +43,88 @@ public:
 
 
     // define a typedefs for handles to the heaps (allow up to quickly update a node in the heap)
-    fibonacci_heap< SIPPNode*, compare<SIPPNode::compare_node> >::
-    handle_type open_handle;
-    fibonacci_heap< SIPPNode*, compare<SIPPNode::secondary_compare_node> >::
-    handle_type focal_handle;
+    typename QueuePolicy::template open_queue<SIPPNodeT, compare_node>::handle_type open_handle;
+    typename QueuePolicy::template focal_queue<SIPPNodeT, secondary_compare_node>::handle_type focal_handle;
+    typename DaryHeap<SIPPNodeT*, typename StateTimeAStarNodeT<QueuePolicy>::compare_f_val>::handle_type pending_handle;
 
 
-    SIPPNode(): StateTimeAStarNode(), parent(nullptr) {}
+    SIPPNodeT(): StateTimeAStarNodeT<QueuePolicy>(), parent(nullptr), next_arrival(nullptr),
+        open_handle(), focal_handle(), pending_handle() {}
 
-    SIPPNode(const State& state, double g_val, double h_val, const Interval& interval,
-            SIPPNode* parent, int conflicts):
-			StateTimeAStarNode(state, g_val, h_val, nullptr, conflicts), parent(parent), interval(interval)
+    SIPPNodeT(const State& state, double g_val, double h_val, const Interval& interval,
+            SIPPNodeT* parent, int conflicts):
+			StateTimeAStarNodeT<QueuePolicy>(state, g_val, h_val, nullptr, conflicts), parent(parent), interval(interval),
+			next_arrival(nullptr), open_handle(), focal_handle(), pending_handle()
 	{
 		if (parent != nullptr)
 		{
-			depth = parent->depth + 1;
-			goal_id = parent->goal_id;
+			this->depth = parent->depth + 1;
+			this->goal_id = parent->goal_id;
 		}
 		else
 		{
-			depth = 0;
-			goal_id = 0;
+			this->depth = 0;
+			this->goal_id = 0;
 		}
 	}
 
 
-    // The following is used to  check whether two nodes are equal
-    // we say that two nodes are equal iff
-    // both agree on the id and timestep
-    struct EqNode
+    // two nodes have the same key iff both agree on the location, the orientation, the safe interval and the goal id
+    inline uint64_t get_key() const
     {
-        bool operator() (const SIPPNode* n1, const SIPPNode* n2) const
-        {
-            return (n1 == n2) ||
-                  (n1 && n2 && n1->state.location == n2->state.location &&
-                  n1->state.orientation == n2->state.orientation &&
-                  n1->interval == n2->interval &&
-                  n1->goal_id == n2->goal_id);
-        }
-    };
+        return pack_node_key(this->state.location, this->state.orientation, std::get<0>(interval), this->goal_id);
+    }
 };
 
 
-class SIPP: public SingleAgentSolver
+// QueuePolicy (see SearchQueue.h) selects the data structures of OPEN and FOCAL
+template<class QueuePolicy>
+class SIPPT: public SingleAgentSolver
 {
 public:
+    typedef SIPPNodeT<QueuePolicy> Node;
+
     Path run(const BasicGraph& G, const State& start,
              const vector<pair<int, int> >& goal_location,
              ReservationTable& RT);
 	string getName() const { return "SIPP"; }
-    SIPP(): SingleAgentSolver() {}
+	void print_node_pool_stats() const { nodes.print_stats(getName()); }
+    SIPPT(): SingleAgentSolver() {}
 
 private:
     // define typedefs and handles for heap and hash_map
-    fibonacci_heap< SIPPNode*, compare<SIPPNode::compare_node> > open_list;
-    fibonacci_heap< SIPPNode*, compare<SIPPNode::secondary_compare_node> > focal_list;
-    unordered_set< SIPPNode*, SIPPNode::Hasher, SIPPNode::EqNode> allNodes_table;
+    typename QueuePolicy::template open_queue<Node, typename Node::compare_node> open_list;
+    typename QueuePolicy::template focal_queue<Node, typename Node::secondary_compare_node> focal_list;
+    // the nodes in OPEN whose f-vals are above the FOCAL bound, so raising the bound moves a prefix of it to FOCAL
+    DaryHeap<Node*, typename Node::compare_f_val> pending_list;
+    NodeTable<Node> allNodes_table;
+    NodePool<Node> nodes; // owns the nodes in allNodes_table
 	inline void releaseClosedListNodes();
+	// the search of run with heuristic values of type Value (see SingleAgentSolver::get_goal_value_type)
+	template<class Value>
+	Path search(const BasicGraph& G, const State& start, const vector<pair<int, int> >& goal_location,
+	            ReservationTable& rt, clock_t t);
 
-    void generate_node(const Interval& interval, SIPPNode* curr, const BasicGraph& G,
+    void generate_node(const Interval& interval, Node* curr, const BasicGraph& G,
                        int location, int min_timestep, int orientation, double h_val);
+    // If waiting at curr is cheaper than waiting at location, also arrive at location later (i.e., wait at curr).
+    // The earliest arrival covers the later ones otherwise.
+    void generate_late_arrivals(const Interval& interval, Node* curr, const BasicGraph& G, ReservationTable& rt,
+                                int location, int min_timestep, int orientation, double h_val);
+    int last_constrained_timestep; // of the reservation table of the current query, -1 until it is needed
+    // Returns a node with the same key as next such that one of the two can wait until the other arrives
+    // at no higher cost, or nullptr if next is not comparable with any of them.
+    Node* find_comparable_node(const Node& next, double wait_cost) const;
+    // whether n1 can wait until n2 arrives at no higher cost
+    static inline bool covers(const Node& n1, const Node& n2, double wait_cost)
+    {
+        return n1.state.timestep <= n2.state.timestep &&
+            n1.g_val + (n2.state.timestep - n1.state.timestep) * wait_cost <= n2.g_val;
+    }
     // Updates the path
-    Path updatePath(const BasicGraph& G, const SIPPNode* goal);
+    Path updatePath(const BasicGraph& G, const Node* goal);
 
 };
 
+typedef SIPPT<FibonacciHeapPolicy> SIPP;
+
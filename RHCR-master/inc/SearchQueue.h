@@ -0,0 +1,335 @@
+#pragma once
+#include "common.h"
+#include "NodePool.h"
+
+
+// Mutable priority queues for the OPEN and FOCAL lists of the single-agent solvers.
+// They follow the interface of boost::heap::fibonacci_heap that the solvers use: Compare(a, b) returns true
+// if a has a lower priority than b, push returns a handle, and increase (priority went up), update and erase
+// take that handle. Handles are pointers to entries that the queue allocates from a NodePool,
+// so they stay valid until clear, which releases all entries at once.
+
+
+// Implicit d-ary heap whose entries know their positions in the array.
+// A larger fan-out makes the heap shallower and sifting down more cache-friendly.
+template<class T, class Compare, int D = 4>
+class DaryHeap
+{
+public:
+    struct Entry
+    {
+        T value;
+        int position;
+    };
+    typedef Entry* handle_type;
+
+    handle_type push(const T& value)
+    {
+        Entry* entry = entries.create(Entry{value, (int)heap.size()});
+        heap.push_back(entry);
+        sift_up(entry->position);
+        return entry;
+    }
+    const T& top() const { return heap.front()->value; }
+    void pop() { erase(heap.front()); }
+    void erase(handle_type handle)
+    {
+        int position = handle->position;
+        Entry* last = heap.back();
+        heap.pop_back();
+        if (last != handle)
+        {
+            place(last, position);
+            update(last);
+        }
+    }
+    void increase(handle_type handle) { sift_up(handle->position); }
+    void update(handle_type handle)
+    {
+        sift_up(handle->position);
+        sift_down(handle->position);
+    }
+    bool empty() const { return heap.empty(); }
+    size_t size() const { return heap.size(); }
+    void clear()
+    {
+        heap.clear();
+        entries.reset();
+    }
+
+private:
+    vector<Entry*> heap;
+    NodePool<Entry> entries;
+    Compare lower_priority;
+
+    void place(Entry* entry, int position)
+    {
+        heap[position] = entry;
+        entry->position = position;
+    }
+    void sift_up(int position)
+    {
+        Entry* entry = heap[position];
+        while (position > 0)
+        {
+            int parent = (position - 1) / D;
+            if (!lower_priority(heap[parent]->value, entry->value))
+                break;
+            place(heap[parent], position);
+            position = parent;
+        }
+        place(entry, position);
+    }
+    void sift_down(int position)
+    {
+        Entry* entry = heap[position];
+        int n = (int)heap.size();
+        while (true)
+        {
+            int first = position * D + 1;
+            if (first >= n)
+                break;
+            int best = first;
+            for (int child = first + 1; child < first + D && child < n; child++)
+            {
+                if (lower_priority(heap[best]->value, heap[child]->value))
+                    best = child;
+            }
+            if (!lower_priority(entry->value, heap[best]->value))
+                break;
+            place(heap[best], position);
+            position = best;
+        }
+        place(entry, position);
+    }
+};
+
+
+// Pairing heap with two-pass merging. Push and increase are O(1) melds, so it suits searches that
+// generate many more nodes than they expand.
+template<class T, class Compare>
+class PairingHeap
+{
+public:
+    struct Entry
+    {
+        T value;
+        Entry* child;
+        Entry* next; // right sibling
+        Entry* prev; // left sibling, or the parent of the leftmost child
+    };
+    typedef Entry* handle_type;
+
+    handle_type push(const T& value)
+    {
+        Entry* entry = entries.create(Entry{value, nullptr, nullptr, nullptr});
+        num_entries++;
+        root = meld(root, entry);
+        return entry;
+    }
+    const T& top() const { return root->value; }
+    void pop() { erase(root); }
+    void erase(handle_type handle)
+    {
+        detach(handle);
+        num_entries--;
+    }
+    void increase(handle_type handle) // the subtree of handle stays heap-ordered
+    {
+        if (handle == root)
+            return;
+        cut(handle);
+        root = meld(root, handle);
+    }
+    void update(handle_type handle)
+    {
+        detach(handle);
+        root = meld(root, handle);
+    }
+    bool empty() const { return root == nullptr; }
+    size_t size() const { return num_entries; }
+    void clear()
+    {
+        root = nullptr;
+        num_entries = 0;
+        entries.reset();
+    }
+
+private:
+    Entry* root = nullptr;
+    size_t num_entries = 0;
+    vector<Entry*> pairs; // buffer of merge_pairs
+    NodePool<Entry> entries;
+    Compare lower_priority;
+
+    Entry* meld(Entry* a, Entry* b) // both are roots
+    {
+        if (a == nullptr)
+            return b;
+        if (b == nullptr)
+            return a;
+        if (lower_priority(a->value, b->value))
+            std::swap(a, b);
+        b->prev = a;
+        b->next = a->child;
+        if (a->child != nullptr)
+            a->child->prev = b;
+        a->child = b;
+        return a;
+    }
+    void cut(Entry* entry) // detach the subtree of a non-root entry
+    {
+        if (entry->prev->child == entry)
+            entry->prev->child = entry->next;
+        else
+            entry->prev->next = entry->next;
+        if (entry->next != nullptr)
+            entry->next->prev = entry->prev;
+        entry->next = nullptr;
+        entry->prev = nullptr;
+    }
+    void detach(Entry* entry) // remove the entry from the heap, keeping its children in the heap
+    {
+        if (entry == root)
+        {
+            root = merge_pairs(entry->child);
+        }
+        else
+        {
+            cut(entry);
+            root = meld(root, merge_pairs(entry->child));
+        }
+        entry->child = nullptr;
+    }
+    Entry* merge_pairs(Entry* first) // meld the siblings pairwise from left to right, then from right to left
+    {
+        if (first == nullptr)
+            return nullptr;
+        pairs.clear();
+        while (first != nullptr)
+        {
+            Entry* a = first;
+            Entry* b = a->next;
+            first = b == nullptr ? nullptr : b->next;
+            a->next = a->prev = nullptr;
+            if (b != nullptr)
+                b->next = b->prev = nullptr;
+            pairs.push_back(meld(a, b));
+        }
+        Entry* result = pairs.back();
+        for (int i = (int)pairs.size() - 2; i >= 0; i--)
+            result = meld(pairs[i], result);
+        return result;
+    }
+};
+
+
+// Bucket queue on the integer part of the f-value, for OPEN lists on unit-cost (or integer-cost) grids.
+// OPEN is only used for the minimum f-value and the FOCAL bound, so nodes within a bucket are not ordered.
+template<class T>
+class FBucketQueue
+{
+public:
+    struct Entry
+    {
+        T value;
+        int bucket;
+        int position; // in the bucket
+    };
+    typedef Entry* handle_type;
+
+    handle_type push(const T& value)
+    {
+        Entry* entry = entries.create(Entry{value, -1, -1});
+        num_entries++;
+        insert(entry);
+        return entry;
+    }
+    const T& top() const
+    {
+        while (buckets[min_bucket].empty())
+            min_bucket++;
+        return buckets[min_bucket].back()->value;
+    }
+    void pop() { top(); erase(buckets[min_bucket].back()); }
+    void erase(handle_type handle)
+    {
+        remove(handle);
+        num_entries--;
+    }
+    void increase(handle_type handle) { update(handle); }
+    void update(handle_type handle)
+    {
+        if (get_bucket(handle->value) == handle->bucket)
+            return;
+        remove(handle);
+        insert(handle);
+    }
+    bool empty() const { return num_entries == 0; }
+    size_t size() const { return num_entries; }
+    void clear()
+    {
+        for (auto& bucket : buckets)
+            bucket.clear();
+        num_entries = 0;
+        entries.reset();
+        min_bucket = 0;
+    }
+
+private:
+    vector<vector<Entry*> > buckets;
+    mutable size_t min_bucket = 0; // no bucket below it is used
+    size_t num_entries = 0;
+    NodePool<Entry> entries;
+
+    static int get_bucket(const T& value) { return max(0, (int)value->getFVal()); }
+    void insert(Entry* entry)
+    {
+        entry->bucket = get_bucket(entry->value);
+        if (entry->bucket >= (int)buckets.size())
+            buckets.resize(entry->bucket + 1);
+        entry->position = (int)buckets[entry->bucket].size();
+        buckets[entry->bucket].push_back(entry);
+        min_bucket = min(min_bucket, (size_t)entry->bucket);
+    }
+    void remove(Entry* entry)
+    {
+        vector<Entry*>& bucket = buckets[entry->bucket];
+        bucket[entry->position] = bucket.back();
+        bucket[entry->position]->position = entry->position;
+        bucket.pop_back();
+    }
+};
+
+
+// Queue policies of the single-agent solvers: Policy::open_queue<Node, Compare> and
+// Policy::focal_queue<Node, Compare> are the types of OPEN and FOCAL.
+struct FibonacciHeapPolicy
+{
+    static constexpr const char* name = "FIBONACCI";
+    template<class Node, class Compare> using open_queue = fibonacci_heap<Node*, compare<Compare> >;
+    template<class Node, class Compare> using focal_queue = fibonacci_heap<Node*, compare<Compare> >;
+};
+
+struct DaryHeapPolicy
+{
+    static constexpr const char* name = "DARY";
+    template<class Node, class Compare> using open_queue = DaryHeap<Node*, Compare>;
+    template<class Node, class Compare> using focal_queue = DaryHeap<Node*, Compare>;
+};
+
+struct PairingHeapPolicy
+{
+    static constexpr const char* name = "PAIRING";
+    template<class Node, class Compare> using open_queue = PairingHeap<Node*, Compare>;
+    template<class Node, class Compare> using focal_queue = PairingHeap<Node*, Compare>;
+};
+
+// FOCAL is ordered by the number of conflicts, so only OPEN uses buckets. top() is only the minimum when all
+// f-values are integers, so the policy must not be used on graphs with non-integral weights.
+struct BucketQueuePolicy
+{
+    static constexpr const char* name = "BUCKET";
+    template<class Node, class Compare> using open_queue = FBucketQueue<Node*>;
+    template<class Node, class Compare> using focal_queue = DaryHeap<Node*, Compare>;
+};
@@ -1,6 +1,7 @@
 #pragma once
 #include "BasicGraph.h"
 #include "ReservationTable.h"
+#include <random>
 
 
 class SingleAgentSolver
@@ -10,6 +11,20 @@ public:
 	bool prioritize_start;
 	double suboptimal_bound;
 	bool hold_endpoints;
+	// A* breaks ties between nodes with the same f- and g-vals towards the most recently generated one,
+	// or randomly with rng if random_tie_breaking is set
+	bool random_tie_breaking = false;
+	std::mt19937 rng;
+	// with a planning window, a node popped beyond the window and the last constraint of the reservation table
+	// is completed by following the heuristic table downhill instead of searching further
+	bool collapse_horizon = false;
+	// Budgets of a single run (0 for none). When a budget runs out, run returns the partial path to the expanded
+	// node that got the furthest towards the end of the planning window (the closest to the goals among ties).
+	// Its path_cost is the cost of the partial path, and min_f_val is the f-value of the start, so that a partial
+	// search never tightens the lower bounds of the high-level solvers.
+	uint64_t expansion_budget = 0;
+	double time_budget = 0; // in seconds
+	bool partial_path = false; // whether the last run returned a partial path
 
 
     uint64_t num_expanded;
@@ -22,15 +37,94 @@ public:
     int num_of_conf; // number of conflicts between this agent to all the other agents
 
 	unordered_map<int, double> travel_times;
+	ostream* query_log = nullptr; // if set, every query is recorded for the queue benchmark
 
+	void record_query(const State& start, const vector<pair<int, int> >& goal_location, const ReservationTable& RT) const;
+	// read a query written by record_query; the settings of the query are applied to this solver
+	bool load_query(std::istream& is, State& start, vector<pair<int, int> >& goal_location, ReservationTable& RT);
+
+	// the orientation of curr is only used by orientation-aware heuristic tables
 	double compute_h_value(const BasicGraph& G, int curr, int goal_id,
-		const vector<pair<int, int> >& goal_location) const;
+		const vector<pair<int, int> >& goal_location, int orientation = -1) const;
+	// Loads the heuristic rows of the goals and sums up the distances between the consecutive goals of a query
+	// once, so that get_h_value is one array load plus one addition. Call it at the start of every query; the rows
+	// stay valid until the next lookup of a heuristics table without the row (in lazy mode).
+	void set_goal_sequence(const BasicGraph& G, const vector<pair<int, int> >& goal_location);
+	// the same as compute_h_value for the goal sequence of the current query
+	inline double get_h_value(const BasicGraph& G, int curr, int goal_id, int orientation = -1) const
+	{
+		switch (goal_value_type)
+		{
+		case HeuristicTable::UINT16:
+			return get_h_value<uint16_t>(G, curr, goal_id, orientation);
+		case HeuristicTable::FLOAT:
+			return get_h_value<float>(G, curr, goal_id, orientation);
+		default:
+			return get_h_value<double>(G, curr, goal_id, orientation);
+		}
+	}
+	// the same for a search that has dispatched on get_goal_value_type once
+	template<class Value>
+	inline double get_h_value(const BasicGraph& G, int curr, int goal_id, int orientation = -1) const
+	{
+		return HeuristicTable::get_from_row(static_cast<const Value*>(goal_rows[goal_id]), goal_num_orientations,
+			curr, orientation) + goal_suffix_costs[goal_id];
+	}
+	HeuristicTable::value_type get_goal_value_type() const { return goal_value_type; }
 
     virtual Path run(const BasicGraph& G, const State& start, const vector<pair<int, int> >& goal_location, ReservationTable& RT) = 0;
+	// Warm-started run: the search stops as soon as it reaches a state of prior_path (e.g., the previous plan of
+	// the agent) from which the rest of prior_path is still unconstrained, conflict-free and a shortest path.
+	Path replan(const BasicGraph& G, const State& start, const vector<pair<int, int> >& goal_location,
+		ReservationTable& RT, const Path& prior_path);
 	virtual string getName() const = 0;
+	virtual void print_node_pool_stats() const {}
 	SingleAgentSolver(): suboptimal_bound(1), num_expanded(0), num_generated(0), min_f_val(0), num_of_conf(0) {}
     virtual ~SingleAgentSolver()= default;
 
 protected:
 	double focal_bound;
+	vector<int> goal_sequence; // the goal locations of the current query
+	vector<double> goal_suffix_costs; // from the i-th goal through the following ones to the last goal
+	vector<const void*> goal_rows; // the heuristic values of the goals (see HeuristicTable::get_row_values)
+	HeuristicTable::value_type goal_value_type = HeuristicTable::DOUBLE;
+	int goal_num_orientations = 1;
+
+	// nodes with larger timesteps can be completed by complete_path; INT_MAX if collapse_horizon is not applicable
+	int get_collapse_timestep(const BasicGraph& G, const ReservationTable& RT) const;
+	// Appends the states from path.back() through the remaining goals of the current query by greedy descent
+	// on the heuristic table. Returns false if the descent gets stuck.
+	bool complete_path(const BasicGraph& G, Path& path, int goal_id, const vector<pair<int, int> >& goal_location) const;
+
+	inline bool out_of_budget(std::clock_t start) const
+	{
+		return (expansion_budget > 0 && num_expanded >= expansion_budget) ||
+			(time_budget > 0 && (num_expanded & 63) == 0 && (double)(std::clock() - start) / CLOCKS_PER_SEC > time_budget);
+	}
+	// whether the partial path to n1 is better than the one to n2 (which can be nullptr)
+	template<class Node>
+	static inline bool better_partial_path(const Node* n1, const Node* n2, int window)
+	{
+		if (n2 == nullptr)
+			return true;
+		int t1 = min(n1->state.timestep, window), t2 = min(n2->state.timestep, window);
+		return t1 > t2 || (t1 == t2 && n1->h_val < n2->h_val);
+	}
+
+	const Path* prior_path = nullptr; // only set during replan
+	vector<int> prior_goal_ids; // timestep -> goal id of a node at the state of prior_path at this timestep
+	vector<bool> prior_reusable; // timestep -> whether the rest of prior_path can be reused from this timestep
+	// Call at the start of every query, before the SIT is built, as the prior path is checked against the CT.
+	void set_prior_path(const BasicGraph& G, const vector<pair<int, int> >& goal_location, const ReservationTable& RT);
+	inline bool can_reuse_prior_path(const State& s, int goal_id) const
+	{
+		return s.timestep < (int)prior_reusable.size() && prior_reusable[s.timestep] &&
+			(*prior_path)[s.timestep].location == s.location && (*prior_path)[s.timestep].orientation == s.orientation &&
+			prior_goal_ids[s.timestep] == goal_id;
+	}
+	void append_prior_path(Path& path) const; // path ends at a state for which can_reuse_prior_path holds
 };
+
+
+// name is ASTAR or SIPP, and queue is the name of a queue policy (see SearchQueue.h); nullptr if either is unknown
+SingleAgentSolver* create_single_agent_solver(const string& name, const string& queue);
@@ -1,54 +1,77 @@
 #pragma once
 #include "SingleAgentSolver.h"
+#include "NodePool.h"
+#include "SearchQueue.h"
+#include "NodeTable.h"
 
 
-class StateTimeAStarNode
+template<class QueuePolicy>
+class StateTimeAStarNodeT
 {
 public:
     State state;
     double g_val;
     double h_val;
-    StateTimeAStarNode* parent;
+    StateTimeAStarNodeT* parent;
     int conflicts;
     int depth;
     bool in_openlist;
     int goal_id; // the id of its current goal.
+    uint64_t tie_breaker; // among nodes with the same f- and g-vals, the one with the largest value goes first
 
     // the following is used to comapre nodes in the OPEN list
     struct compare_node
     {
         // returns true if n1 > n2 (note -- this gives us *min*-heap).
-        bool operator()(const StateTimeAStarNode* n1, const StateTimeAStarNode* n2) const
+        bool operator()(const StateTimeAStarNodeT* n1, const StateTimeAStarNodeT* n2) const
         {
             if (n1->g_val + n1->h_val == n2->g_val + n2->h_val)
-                return rand() % 2 == 0;  // break ties randomly
-            return n1->g_val + n1->h_val >= n2->g_val + n2->h_val;
+            {
+                if (n1->g_val == n2->g_val)
+                    return n1->tie_breaker < n2->tie_breaker;
+                return n1->g_val < n2->g_val;  // break ties towards larger g_vals
+            }
+            return n1->g_val + n1->h_val > n2->g_val + n2->h_val;
         }
     };  // used by OPEN (heap) to compare nodes (top of the heap has min f-val, and then highest g-val)
 
     // the following is used to comapre nodes in the FOCAL list
     struct secondary_compare_node
     {
-        bool operator()(const StateTimeAStarNode* n1, const StateTimeAStarNode* n2) const // returns true if n1 > n2
+        bool operator()(const StateTimeAStarNodeT* n1, const StateTimeAStarNodeT* n2) const // returns true if n1 > n2
         {
             if (n1->conflicts == n2->conflicts)
             {
-                return n1->g_val <= n2->g_val;  // break ties towards larger g_vals
+                if (n1->g_val == n2->g_val)
+                    return n1->tie_breaker < n2->tie_breaker;
+                return n1->g_val < n2->g_val;  // break ties towards larger g_vals
             }
-            return n1->conflicts >= n2->conflicts;  // n1 > n2 if it has more conflicts
+            return n1->conflicts > n2->conflicts;  // n1 > n2 if it has more conflicts
         }
     };  // used by FOCAL (heap) to compare nodes (top of the heap has min number-of-conflicts)
 
+    // the following is used to comapre nodes in the PENDING list
+    struct compare_f_val
+    {
+        bool operator()(const StateTimeAStarNodeT* n1, const StateTimeAStarNodeT* n2) const // returns true if n1 > n2
+        {
+            if (n1->g_val + n1->h_val == n2->g_val + n2->h_val)
+                return n1->g_val < n2->g_val;  // break ties towards larger g_vals
+            return n1->g_val + n1->h_val > n2->g_val + n2->h_val;
+        }
+    };  // used by PENDING (heap) to compare nodes (top of the heap has min f-val)
+
 
     // define a typedefs for handles to the heaps (allow up to quickly update a node in the heap)
-    fibonacci_heap< StateTimeAStarNode*, compare<StateTimeAStarNode::compare_node> >::
-        handle_type open_handle;
-    fibonacci_heap< StateTimeAStarNode*, compare<StateTimeAStarNode::secondary_compare_node> >::
-        handle_type focal_handle;
-
-    StateTimeAStarNode(): g_val(0), h_val(0), parent(nullptr), conflicts(0), depth(0), in_openlist(false), goal_id(0) {}
-    StateTimeAStarNode(const State& state, double g_val, double h_val, StateTimeAStarNode* parent, int conflicts):
-        state(state), g_val(g_val), h_val(h_val), parent(parent), conflicts(conflicts), in_openlist(false)
+    typename QueuePolicy::template open_queue<StateTimeAStarNodeT, compare_node>::handle_type open_handle;
+    typename QueuePolicy::template focal_queue<StateTimeAStarNodeT, secondary_compare_node>::handle_type focal_handle;
+    typename DaryHeap<StateTimeAStarNodeT*, compare_f_val>::handle_type pending_handle;
+
+    StateTimeAStarNodeT(): g_val(0), h_val(0), parent(nullptr), conflicts(0), depth(0), in_openlist(false), goal_id(0),
+        tie_breaker(0), open_handle(), focal_handle(), pending_handle() {}
+    StateTimeAStarNodeT(const State& state, double g_val, double h_val, StateTimeAStarNodeT* parent, int conflicts):
+        state(state), g_val(g_val), h_val(h_val), parent(parent), conflicts(conflicts), in_openlist(false),
+        tie_breaker(0), open_handle(), focal_handle(), pending_handle()
     {
         if(parent != nullptr)
         {
@@ -78,53 +101,52 @@ public:
 
     inline double getFVal() const { return g_val + h_val; }
 
-
-    // The following is used to  check whether two nodes are equal
-    // we say that two nodes are equal iff
-    // both agree on the state and the goal id
-    struct EqNode
-    {
-        bool operator() (const StateTimeAStarNode* n1, const StateTimeAStarNode* n2) const
-        {
-            return (n1 == n2) ||
-                   (n1 && n2 && n1->state == n2->state && n1->goal_id == n2->goal_id);
-        }
-    };
-
-    // The following is used to generate the hash value of a node
-    struct Hasher
-    {
-        std::size_t operator()(const StateTimeAStarNode* n) const
-        {
-            return State::Hasher()(n->state);
-        }
-    };
+    // two nodes are the same iff both agree on the state and the goal id
+    inline uint64_t get_key() const { return pack_node_key(state.location, state.orientation, state.timestep, goal_id); }
 };
 
+typedef StateTimeAStarNodeT<FibonacciHeapPolicy> StateTimeAStarNode;
+
 
-class StateTimeAStar: public SingleAgentSolver
+// QueuePolicy (see SearchQueue.h) selects the data structures of OPEN and FOCAL
+template<class QueuePolicy>
+class StateTimeAStarT: public SingleAgentSolver
 {
 public:
+    typedef StateTimeAStarNodeT<QueuePolicy> Node;
+
     // find path by time-space A* search
     Path run(const BasicGraph& G, const State& start, const vector<pair<int, int> >& goal_location,
                   ReservationTable& RT);
 
 	string getName() const { return "AStar"; }
+	void print_node_pool_stats() const { nodes.print_stats(getName()); }
     void findTrajectory(const BasicGraph& G,
                         const State& start,
                         const vector<pair<int, int> >& goal_locations,
                         const unordered_map<int, double>& travel_times,
                         list<pair<int, int> >& path);
-    StateTimeAStar(): SingleAgentSolver() {}
+    StateTimeAStarT(): SingleAgentSolver() {}
 
 private:
 	// define typedefs and handles for heap and hash_map
-	fibonacci_heap< StateTimeAStarNode*, compare<StateTimeAStarNode::compare_node> > open_list;
-	fibonacci_heap< StateTimeAStarNode*, compare<StateTimeAStarNode::secondary_compare_node> > focal_list;
-	unordered_set< StateTimeAStarNode*, StateTimeAStarNode::Hasher, StateTimeAStarNode::EqNode> allNodes_table;
+	typename QueuePolicy::template open_queue<Node, typename Node::compare_node> open_list;
+	typename QueuePolicy::template focal_queue<Node, typename Node::secondary_compare_node> focal_list;
+	// the nodes in OPEN whose f-vals are above the FOCAL bound, so raising the bound moves a prefix of it to FOCAL
+	DaryHeap<Node*, typename Node::compare_f_val> pending_list;
+	NodeTable<Node> allNodes_table;
+	NodePool<Node> nodes; // owns the nodes in allNodes_table
 	inline void releaseClosedListNodes();
+	// the search of run with heuristic values of type Value (see SingleAgentSolver::get_goal_value_type)
+	template<class Value>
+	Path search(const BasicGraph& G, const State& start, const vector<pair<int, int> >& goal_location,
+	            ReservationTable& rt, clock_t t);
+	// call before counting the new node in num_generated
+	inline uint64_t get_tie_breaker() { return random_tie_breaking ? rng() : num_generated; }
 
     // Updates the path
-    Path updatePath(const StateTimeAStarNode* goal);
-    list<pair<int, int> > updateTrajectory(const StateTimeAStarNode* goal);
+    Path updatePath(const Node* goal);
+    list<pair<int, int> > updateTrajectory(const Node* goal);
 };
+
+typedef StateTimeAStarT<FibonacciHeapPolicy> StateTimeAStar;
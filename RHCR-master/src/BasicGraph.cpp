@@ -1,10 +1,118 @@
 #include "BasicGraph.h"
 #include <fstream>
 #include <boost/tokenizer.hpp>
-#include "StateTimeAStar.h"
+#include "HeuristicSearch.h"
 #include <sstream>
 #include <random>
 #include <chrono>
+#include <thread>
+#include <atomic>
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+// Binary heuristics table (version 3):
+//   HeuristicsTableHeader
+//   int32_t roots[num_roots], padded with zeros to a multiple of 8 bytes
+//   value distances[num_roots][rows * cols * num_orientations], where row r holds the distances
+//   from all locations (or all (location, orientation) states) to roots[r]
+// The values have the smallest HeuristicTable::value_type that holds every distance (uint16_t, float or double).
+// Everything is stored in the native byte order, so that the file can be mapped and its distances used in place.
+struct HeuristicsTableHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t consider_rotation;
+    uint64_t map_hash;
+    int32_t rows;
+    int32_t cols;
+    uint64_t num_roots;
+    uint32_t num_orientations; // 4 for orientation-aware tables, 1 otherwise
+    uint32_t value_type; // HeuristicTable::value_type of the distances
+};
+
+static const char HEURISTICS_TABLE_MAGIC[8] = {'R', 'H', 'C', 'R', 'H', 'E', 'U', 'R'};
+static const uint32_t HEURISTICS_TABLE_VERSION = 3;
+
+static size_t get_roots_bytes(uint64_t num_roots) { return (num_roots * sizeof(int32_t) + 7) / 8 * 8; }
+
+template<class Value>
+static void write_heuristics(std::ofstream& myfile, const vector<double>& h_values)
+{
+    vector<Value> values(h_values.size());
+    for (size_t i = 0; i < h_values.size(); i++)
+        values[i] = HeuristicTable::encode<Value>(h_values[i]);
+    myfile.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(Value));
+}
+
+
+// Read-only view of a whole file. The pages are shared with every other process that maps the same file
+// (on Windows, the file is read into memory instead).
+class MappedFile
+{
+public:
+    const char* data = nullptr;
+    size_t size = 0;
+
+    bool open(const string& fname)
+    {
+#ifdef _WIN32
+        std::ifstream myfile(fname.c_str(), std::ios::binary | std::ios::ate);
+        if (!myfile.is_open())
+            return false;
+        buffer.resize((size_t)myfile.tellg());
+        myfile.seekg(0);
+        myfile.read(buffer.data(), buffer.size());
+        data = buffer.data();
+        size = buffer.size();
+        return (bool)myfile;
+#else
+        int fd = ::open(fname.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        void* addr = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd); // the mapping stays valid after closing the descriptor
+        if (addr == MAP_FAILED)
+            return false;
+        data = static_cast<const char*>(addr);
+        size = (size_t)st.st_size;
+        return true;
+#endif
+    }
+
+    ~MappedFile()
+    {
+#ifndef _WIN32
+        if (data != nullptr)
+            munmap(const_cast<char*>(data), size);
+#endif
+    }
+
+private:
+#ifdef _WIN32
+    vector<char> buffer;
+#endif
+};
+
+
+// The prefetching thread reads weights and the neighbor tables, which are destroyed before heuristics.
+BasicGraph::~BasicGraph()
+{
+    heuristics.stop_prefetching();
+}
 
 
 void BasicGraph::print_map() const
@@ -15,17 +123,50 @@ void BasicGraph::print_map() const
     std::cout << std::endl;
 
     std::cout << "***weights***" << std::endl;
-    for (std::vector<double> n : weights)
+    for (int loc = 0; loc < this->size(); loc++)
     {
-        for (double w : n)
+        for (int dir = 0; dir < 5; dir++)
         {
-            std::cout << w << ",";
+            std::cout << get_weight_in_direction(loc, dir) << ",";
         }
         std::cout << std::endl;
     }
 }
 
 
+cell_type get_cell_type(const string& name)
+{
+    static const string names[] = {"Travel", "Obstacle", "Endpoint", "Home", "Induct", "Eject", "Magic", "Entry", "Exit"};
+    for (int i = 0; i < OTHER_CELL; i++)
+    {
+        if (name == names[i])
+            return (cell_type)i;
+    }
+    return OTHER_CELL;
+}
+
+
+void BasicGraph::build_cell_types()
+{
+    cell_types.resize(types.size());
+    type_bitsets.assign(CELL_TYPE_COUNT, vector<uint64_t>((types.size() + 63) / 64, 0));
+    for (int loc = 0; loc < (int)types.size(); loc++)
+    {
+        cell_types[loc] = get_cell_type(types[loc]);
+        type_bitsets[cell_types[loc]][loc >> 6] |= (uint64_t)1 << (loc & 63);
+    }
+}
+
+
+void BasicGraph::set_type(int loc, const string& name)
+{
+    type_bitsets[cell_types[loc]][loc >> 6] &= ~((uint64_t)1 << (loc & 63));
+    types[loc] = name;
+    cell_types[loc] = get_cell_type(name);
+    type_bitsets[cell_types[loc]][loc >> 6] |= (uint64_t)1 << (loc & 63);
+}
+
+
 int BasicGraph::get_rotate_degree(int dir1, int dir2) const
 {
     if (dir1 == dir2)
@@ -44,97 +185,87 @@ list<int> BasicGraph::get_neighbors(int v) const
         return neighbors;
 
     for (int i = 0; i < 4; i++) // move
-        if (weights[v][i] < WEIGHT_MAX - 1)
+        if (valid_move(v, i))
             neighbors.push_back(v + move[i]);
 
     return neighbors;
 }
 
-list<State> BasicGraph::get_neighbors(const State& s) const
+void BasicGraph::build_neighbor_table()
 {
-    list<State> neighbors;
-    if (s.location < 0)
-        return neighbors;
-    if (s.orientation >= 0)
+    int num_states = consider_rotation ? this->size() * 4 : this->size();
+    successor_offsets.assign(1, 0);
+    successors.clear();
+    predecessor_offsets.assign(1, 0);
+    predecessors.clear();
+    successors.reserve(num_states * 5);
+    predecessors.reserve(num_states * 4);
+    auto add = [](vector<Neighbor>& neighbors, int location, int orientation, double weight)
     {
-        neighbors.push_back(State(s.location, s.timestep + 1, s.orientation)); // wait
-        if (weights[s.location][s.orientation] < WEIGHT_MAX - 1)
-            neighbors.push_back(State(s.location + move[s.orientation], s.timestep + 1, s.orientation)); // move
-        int next_orientation1 = s.orientation + 1;
-        int next_orientation2 = s.orientation - 1;
-        if (next_orientation2 < 0)
-            next_orientation2 += 4;
-        else if (next_orientation1 > 3)
-            next_orientation1 -= 4;
-        neighbors.push_back(State(s.location, s.timestep + 1, next_orientation1)); // turn left
-        neighbors.push_back(State(s.location, s.timestep + 1, next_orientation2)); // turn right
-    }
-    else
+        neighbors.push_back(Neighbor{location, orientation, weight});
+    };
+    for (int loc = 0; loc < this->size(); loc++)
     {
-        neighbors.push_back(State(s.location, s.timestep + 1)); // wait
-        for (int i = 0; i < 4; i++) // move
-            if (weights[s.location][i] < WEIGHT_MAX - 1)
-                neighbors.push_back(State(s.location + move[i], s.timestep + 1));
-    }
-    return neighbors;
-}    
-
-std::list<State> BasicGraph::get_reverse_neighbors(const State& s) const
-{
-    std::list<State> rneighbors;
-    // no wait actions
-    if (s.orientation >= 0)
-    {
-        if (s.location - move[s.orientation] >= 0 && s.location - move[s.orientation] < this->size() &&
-            weights[s.location - move[s.orientation]][s.orientation] < WEIGHT_MAX - 1)
-            rneighbors.push_back(State(s.location - move[s.orientation], -1, s.orientation)); // move
-        int next_orientation1 = s.orientation + 1;
-        int next_orientation2 = s.orientation - 1;
-        if (next_orientation2 < 0)
-            next_orientation2 += 4;
-        else if (next_orientation1 > 3)
-            next_orientation1 -= 4;
-        rneighbors.push_back(State(s.location, -1, next_orientation1)); // turn right
-        rneighbors.push_back(State(s.location, -1, next_orientation2)); // turn left
-    }
-    else
-    {
-        for (int i = 0; i < 4; i++) // move
-            if (s.location - move[i] >= 0 && s.location - move[i] < this->size() &&
-                    weights[s.location - move[i]][i] < WEIGHT_MAX - 1)
-                rneighbors.push_back(State(s.location - move[i]));
-    }
-    return rneighbors;
-}
+        if (consider_rotation)
+        {
+            for (int orientation = 0; orientation < 4; orientation++)
+            {
+                int orientation1 = (orientation + 1) % 4;
+                int orientation2 = (orientation + 3) % 4;
+                add(successors, loc, orientation, get_weight_in_direction(loc, 4)); // wait
+                if (valid_move(loc, orientation))
+                    add(successors, loc + move[orientation], orientation,
+                        get_weight(loc, loc + move[orientation])); // move
+                add(successors, loc, orientation1, get_weight_in_direction(loc, 4)); // turn left
+                add(successors, loc, orientation2, get_weight_in_direction(loc, 4)); // turn right
+                successor_offsets.push_back((int)successors.size());
 
+                int prev = loc - move[orientation];
+                if (prev >= 0 && prev < this->size() && valid_move(prev, orientation))
+                    add(predecessors, prev, orientation, get_weight(prev, loc)); // move
+                add(predecessors, loc, orientation1, get_weight_in_direction(loc, 4)); // turn right
+                add(predecessors, loc, orientation2, get_weight_in_direction(loc, 4)); // turn left
+                predecessor_offsets.push_back((int)predecessors.size());
+            }
+        }
+        else
+        {
+            add(successors, loc, -1, get_weight_in_direction(loc, 4)); // wait
+            for (int i = 0; i < 4; i++) // move
+            {
+                if (valid_move(loc, i))
+                    add(successors, loc + move[i], -1, get_weight(loc, loc + move[i]));
+            }
+            successor_offsets.push_back((int)successors.size());
 
-double BasicGraph::get_weight(int from, int to) const
-{
-    if (from == to) // wait or rotate
-        return weights[from][4];
-    int dir = get_direction(from, to);
-    if (dir >= 0)
-        return weights[from][dir];
-    else
-        return WEIGHT_MAX;
+            for (int i = 0; i < 4; i++) // move
+            {
+                int prev = loc - move[i];
+                if (prev >= 0 && prev < this->size() && valid_move(prev, i))
+                    add(predecessors, prev, -1, get_weight(prev, loc));
+            }
+            predecessor_offsets.push_back((int)predecessors.size());
+        }
+    }
 }
 
 
-int BasicGraph::get_direction(int from, int to) const
+void BasicGraph::init_weights()
 {
-    for (int i = 0; i < 4; i++)
+    for (int dir = 0; dir < 4; dir++)
+        move[dir] = DIRECTION_OFFSETS[dir][0] * cols + DIRECTION_OFFSETS[dir][1];
+    direction_of.assign(2 * cols + 1, -1);
+    for (int dir = 4; dir >= 0; dir--) // the smallest direction wins if two moves coincide
     {
-        if (move[i] == to - from)
-            return i;
+        int diff = DIRECTION_OFFSETS[dir][0] * cols + DIRECTION_OFFSETS[dir][1];
+        if (-cols <= diff && diff <= cols)
+            direction_of[diff + cols] = (int8_t)dir;
     }
-    if (from == to)
-        return 4;
-    return -1;
+    weights.assign(5 * (size_t)this->size(), WEIGHT_MAX);
 }
 
 
-
-bool BasicGraph::load_heuristics_table(std::ifstream& myfile)
+bool BasicGraph::load_text_heuristics_table(std::ifstream& myfile)
 {
     boost::char_separator<char> sep(",");
     boost::tokenizer< boost::char_separator<char> >::iterator beg;
@@ -160,94 +291,398 @@ bool BasicGraph::load_heuristics_table(std::ifstream& myfile)
         for (int j = 0; j < this->size(); j++)
         {
             h_table[j] = atof((*beg).c_str());
-            if (h_table[j] >= INT_MAX && types[j] != "Obstacle")
-                types[j] = "Obstacle";
+            if (h_table[j] >= 1.79769e+308) // DBL_MAX printed with the default precision
+                h_table[j] = DBL_MAX;
+            if (h_table[j] >= INT_MAX && !is_type(j, OBSTACLE))
+                set_type(j, "Obstacle");
             beg++;
         }
-        heuristics[loc] = h_table;
+        heuristics.insert(loc, h_table);
     }
 	return true;
 }
 
 
-void BasicGraph::save_heuristics_table(std::string fname)
+bool BasicGraph::load_heuristics_table(const string& fname)
 {
-    std::ofstream myfile;
-	myfile.open (fname);
-	myfile << "table_size" << std::endl << 
-        heuristics.size() << "," << this->size() << std::endl;
-	for (auto h_values: heuristics) 
-	{
-        myfile << h_values.first << std::endl;
-		for (double h : h_values.second) 
-		{
-            myfile << h << ",";
-		}
-		myfile << std::endl;
-	}
-	myfile.close();
+    auto mapped_file = std::make_shared<MappedFile>();
+    const MappedFile& file = *mapped_file;
+    if (!mapped_file->open(fname))
+        return false;
+    HeuristicsTableHeader header;
+    if (file.size < sizeof(header))
+        return false;
+    memcpy(&header, file.data, sizeof(header));
+    if (memcmp(header.magic, HEURISTICS_TABLE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != HEURISTICS_TABLE_VERSION || header.value_type > HeuristicTable::DOUBLE)
+    {
+        cout << "The heuristics table " << fname << " has an unknown format." << endl;
+        return false;
+    }
+    int num_orientations = heuristics.get_num_orientations();
+    if (header.rows != rows || header.cols != cols || header.consider_rotation != (uint32_t)consider_rotation ||
+        header.num_orientations != (uint32_t)num_orientations || header.map_hash != get_map_hash())
+    {
+        cout << "The heuristics table " << fname << " does not match the map." << endl;
+        return false;
+    }
+    size_t roots_bytes = get_roots_bytes(header.num_roots);
+    int row_size = this->size() * num_orientations;
+    auto type = (HeuristicTable::value_type)header.value_type;
+    if (file.size != sizeof(header) + roots_bytes + header.num_roots * row_size * HeuristicTable::get_value_size(type))
+    {
+        cout << "The heuristics table " << fname << " is truncated." << endl;
+        return false;
+    }
+
+    const auto* roots = reinterpret_cast<const int32_t*>(file.data + sizeof(header));
+    for (uint64_t i = 0; i < header.num_roots; i++)
+    {
+        if (roots[i] < 0 || roots[i] >= this->size())
+        {
+            cout << "The heuristics table " << fname << " has an invalid root." << endl;
+            return false;
+        }
+    }
+    // the lookups read the distances from the mapping, which the table keeps alive
+    heuristics.map(vector<int>(roots, roots + header.num_roots), file.data + sizeof(header) + roots_bytes, type,
+                   row_size, mapped_file);
+    for (int row = 0; row < (int)header.num_roots; row++)
+    {
+        for (int j = 0; j < this->size(); j++)
+        {
+            if (heuristics.get_by_row(row, j) >= INT_MAX && !is_type(j, OBSTACLE))
+                set_type(j, "Obstacle");
+        }
+    }
+    return true;
 }
 
-std::vector<double> BasicGraph::compute_heuristics(int root_location)
+
+bool BasicGraph::save_heuristics_table(const string& fname) const
 {
-    std::vector<double> res(this->size(), DBL_MAX);
-	fibonacci_heap< StateTimeAStarNode*, compare<StateTimeAStarNode::compare_node> > heap;
-    unordered_set< StateTimeAStarNode*, StateTimeAStarNode::Hasher, StateTimeAStarNode::EqNode> nodes;
+    HeuristicsTableHeader header;
+    memcpy(header.magic, HEURISTICS_TABLE_MAGIC, sizeof(header.magic));
+    header.version = HEURISTICS_TABLE_VERSION;
+    header.consider_rotation = consider_rotation;
+    header.map_hash = get_map_hash();
+    header.rows = rows;
+    header.cols = cols;
+    header.num_roots = heuristics.size();
+    header.num_orientations = heuristics.get_num_orientations();
+    header.value_type = heuristics.get_smallest_type();
+
+    vector<int32_t> roots(heuristics.get_roots().begin(), heuristics.get_roots().end());
+    std::sort(roots.begin(), roots.end());
+    roots.resize(get_roots_bytes(roots.size()) / sizeof(int32_t), 0); // padding
 
-    State root_state(root_location);
-    if(consider_rotation)
+    // write to a temporary file and rename it, so that a process mapping fname never sees a partial table
+    string tmp_fname = fname + ".tmp" + std::to_string(std::random_device()());
+    std::ofstream myfile(tmp_fname.c_str(), std::ios::binary);
+    myfile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    myfile.write(reinterpret_cast<const char*>(roots.data()), roots.size() * sizeof(int32_t));
+    vector<double> h_values;
+    for (uint64_t i = 0; i < header.num_roots; i++)
     {
-        for (auto neighbor : get_reverse_neighbors(root_state))
+        heuristics.get_values(roots[i], h_values);
+        switch (header.value_type)
         {
-            StateTimeAStarNode* root = new StateTimeAStarNode(State(root_location, -1,
-                    get_direction(neighbor.location, root_state.location)), 0, 0, nullptr, 0);
-            root->open_handle = heap.push(root);  // add root to heap
-            nodes.insert(root);       // add root to hash_table (nodes)
+        case HeuristicTable::UINT16:
+            write_heuristics<uint16_t>(myfile, h_values);
+            break;
+        case HeuristicTable::FLOAT:
+            write_heuristics<float>(myfile, h_values);
+            break;
+        default:
+            write_heuristics<double>(myfile, h_values);
+            break;
         }
     }
-    else
+    myfile.close();
+    if (!myfile || std::rename(tmp_fname.c_str(), fname.c_str()) != 0)
+    {
+        std::remove(tmp_fname.c_str());
+        std::cout << "Failed to save heuristics table " << fname << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+bool BasicGraph::convert_heuristics_table(const string& text_fname, const string& binary_fname)
+{
+    std::ifstream myfile(text_fname.c_str());
+    if (!myfile.is_open())
+        return false;
+    bool succ = load_text_heuristics_table(myfile);
+    myfile.close();
+    if (!succ)
+        return false;
+    if (!save_heuristics_table(binary_fname))
+        return true; // the table is loaded all the same
+    std::cout << "Converted heuristics table " << text_fname << " to " << binary_fname << std::endl;
+    return true;
+}
+
+
+// FNV-1a over the grid size and the edge weights, which are all that the distances depend on
+uint64_t BasicGraph::get_map_hash() const
+{
+    uint64_t hash = 14695981039346656037ULL;
+    auto add = [&hash](const void* data, size_t size)
+    {
+        const auto* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+    };
+    add(&rows, sizeof(rows));
+    add(&cols, sizeof(cols));
+    for (int loc = 0; loc < this->size(); loc++) // cell by cell, as in the map files
+    {
+        for (int dir = 0; dir < 5; dir++)
+        {
+            double w = get_weight_in_direction(loc, dir);
+            add(&w, sizeof(w));
+        }
+    }
+    return hash;
+}
+
+// Each root gets its own pre-sized slot, so the worker threads never write to a shared container
+// and heuristics is filled in afterwards by the calling thread.
+void BasicGraph::compute_heuristics_table(const vector<int>& roots)
+{
+    clock_t t = std::clock();
+    auto start = std::chrono::steady_clock::now();
+    bool per_orientation = consider_rotation && oriented_heuristics;
+    if (heuristics.get_num_orientations() != (per_orientation ? 4 : 1))
+        heuristics.set_num_orientations(per_orientation ? 4 : 1);
+    vector<int> unique_roots;
+    vector<bool> added(this->size(), false);
+    for (int root : roots)
     {
-        StateTimeAStarNode* root = new StateTimeAStarNode(root_state, 0, 0, nullptr, 0);
-        root->open_handle = heap.push(root);  // add root to heap
-        nodes.insert(root);       // add root to hash_table (nodes)
+        if (!added[root])
+        {
+            unique_roots.push_back(root);
+            added[root] = true;
+        }
     }
 
-	while (!heap.empty()) 
+    vector<vector<double> > tables(unique_roots.size());
+    std::atomic<size_t> next_root(0);
+    auto worker = [&]()
     {
-        StateTimeAStarNode* curr = heap.top();
-		heap.pop();
-		for (auto next_state : get_reverse_neighbors(curr->state))
-		{
-			double next_g_val = curr->g_val + get_weight(next_state.location, curr->state.location);
-            StateTimeAStarNode* next = new StateTimeAStarNode(next_state, next_g_val, 0, nullptr, 0);
-			auto it = nodes.find(next);
-			if (it == nodes.end()) 
-			{  // add the newly generated node to heap and hash table
-				next->open_handle = heap.push(next);
-				nodes.insert(next);
-			}
-			else 
-			{  // update existing node's g_val if needed (only in the heap)
-				delete(next);  // not needed anymore -- we already generated it before
-                StateTimeAStarNode* existing_next = *it;
-				if (existing_next->g_val > next_g_val) 
-				{
-					existing_next->g_val = next_g_val;
-					heap.increase(existing_next->open_handle);
-				}
-			}
-		}
-	}
-	// iterate over all nodes and populate the distances
-	for (auto it = nodes.begin(); it != nodes.end(); it++)
-	{
-        StateTimeAStarNode* s = *it;
-		res[s->state.location] = std::min(s->g_val, res[s->state.location]);
-		delete (s);
-	}
-	nodes.clear();
-	heap.clear();
-    return res;
+        HeuristicSearch search(*this); // reuses its buffers across roots
+        for (size_t i = next_root++; i < unique_roots.size(); i = next_root++)
+            tables[i] = search.run(unique_roots[i], per_orientation);
+    };
+    int threads_used = (int)min((size_t)max(num_threads, 1), max(unique_roots.size(), (size_t)1));
+    vector<std::thread> threads;
+    for (int i = 1; i < threads_used; i++)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& thread : threads)
+        thread.join();
+
+    for (size_t i = 0; i < unique_roots.size(); i++)
+    {
+        heuristics.insert(unique_roots[i], tables[i]);
+        tables[i] = vector<double>();
+    }
+
+    double runtime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Computed " << unique_roots.size() << " heuristic tables with " << threads_used << " threads ("
+        << runtime << " s wall, " << (std::clock() - t) * 1.0 / CLOCKS_PER_SEC << " s cpu)" << std::endl;
+}
+
+
+void BasicGraph::build_heuristics_table(const vector<int>& roots)
+{
+    bool per_orientation = consider_rotation && oriented_heuristics;
+    heuristics.set_num_orientations(per_orientation ? 4 : 1);
+    if (lazy_heuristics)
+    {
+        heuristics.set_lazy(size(), [this, per_orientation](int root) { return compute_heuristics(root, per_orientation); },
+            (size_t)(heuristics_memory * 1048576), prefetch_heuristics);
+        std::cout << "Heuristic tables are computed on demand (" << heuristics_memory << " MB"
+            << (prefetch_heuristics ? ", prefetching" : "") << ")" << std::endl;
+        return;
+    }
+    string fname = map_name + (consider_rotation ? "_rotation" : "") + (per_orientation ? "_oriented" : "") +
+        "_heuristics_table";
+    auto start = std::chrono::steady_clock::now();
+    bool succ = load_heuristics_table(fname + ".bin");
+    if (!succ && !per_orientation) // text tables only hold distances per location
+        succ = convert_heuristics_table(fname + ".txt", fname + ".bin");
+    double runtime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (succ)
+        std::cout << "Loaded heuristics table " << fname << ".bin (" << runtime << " s)" << std::endl;
+
+    vector<int> missing_roots;
+    for (int root : roots)
+    {
+        if (!heuristics.contains(root))
+            missing_roots.push_back(root);
+    }
+    if (!missing_roots.empty())
+    {
+        compute_heuristics_table(missing_roots);
+
+        start = std::chrono::steady_clock::now();
+        if (save_heuristics_table(fname + ".bin"))
+        {
+            runtime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "Saved heuristics table " << fname << ".bin (" << runtime << " s)" << std::endl;
+        }
+    }
+
+    heuristics.shrink_to_fit();
+    const string value_types[] = {"uint16", "float", "double"};
+    std::cout << "Heuristics table: " << heuristics.size() << " roots, "
+        << heuristics.get_memory_usage() / 1048576.0 << " MB ("
+        << value_types[heuristics.get_value_type()] << (heuristics.is_mapped() ? ", mapped" : "") << ")" << std::endl;
+}
+
+
+std::vector<double> BasicGraph::compute_heuristics(int root_location, bool per_orientation) const
+{
+    HeuristicSearch search(*this);
+    return search.run(root_location, per_orientation);
+}
+
+
+void BasicGraph::update_weights(const vector<WeightUpdate>& updates)
+{
+    vector<WeightUpdate> changes;
+    for (const auto& update : updates)
+    {
+        auto it = update.direction < 4 ? blocked_cells.find(update.location + move[update.direction]) : blocked_cells.end();
+        if (it != blocked_cells.end())
+            it->second[update.direction] = update.weight;
+        else
+            changes.push_back(update);
+    }
+    apply_weight_updates(changes);
+}
+
+
+void BasicGraph::block_cell(int loc)
+{
+    if (is_blocked(loc))
+        return;
+    vector<double> saved(4, WEIGHT_MAX);
+    vector<WeightUpdate> changes;
+    for (int dir = 0; dir < 4; dir++)
+    {
+        int prev = loc - move[dir];
+        if (prev >= 0 && prev < this->size())
+        {
+            saved[dir] = get_weight_in_direction(prev, dir);
+            changes.push_back(WeightUpdate{prev, dir, WEIGHT_MAX});
+        }
+    }
+    blocked_cells[loc] = saved;
+    apply_weight_updates(changes);
+}
+
+
+void BasicGraph::unblock_cell(int loc)
+{
+    auto it = blocked_cells.find(loc);
+    if (it == blocked_cells.end())
+        return;
+    vector<WeightUpdate> changes;
+    for (int dir = 0; dir < 4; dir++)
+    {
+        int prev = loc - move[dir];
+        if (prev >= 0 && prev < this->size())
+            changes.push_back(WeightUpdate{prev, dir, it->second[dir]});
+    }
+    blocked_cells.erase(it);
+    apply_weight_updates(changes);
+}
+
+
+void BasicGraph::apply_weight_updates(const vector<WeightUpdate>& updates)
+{
+    heuristics.cancel_prefetching(); // the background thread reads the weights and the neighbor tables
+    vector<int> changed_locations;
+    for (const auto& update : updates)
+    {
+        if (get_weight_in_direction(update.location, update.direction) == update.weight)
+            continue;
+        set_weight(update.location, update.direction, update.weight);
+        changed_locations.push_back(update.location);
+    }
+    if (changed_locations.empty())
+        return;
+    std::sort(changed_locations.begin(), changed_locations.end());
+    changed_locations.erase(std::unique(changed_locations.begin(), changed_locations.end()), changed_locations.end());
+    build_neighbor_table();
+    repair_heuristics(changed_locations);
+}
+
+
+// Only the distances of the edges' source states can change directly, so the repair starts from them.
+// Tables with one distance per location under rotation keep the minimum over orientations, which cannot be
+// repaired, so they are recomputed.
+void BasicGraph::repair_heuristics(const vector<int>& changed_locations)
+{
+    auto start = std::chrono::steady_clock::now();
+    bool incremental = heuristics.get_num_orientations() == (consider_rotation ? 4 : 1);
+    const vector<int>& roots = heuristics.get_roots();
+    vector<vector<double> > tables(roots.size());
+    std::atomic<size_t> next_root(0);
+    std::atomic<uint64_t> num_expanded(0);
+    auto worker = [&]()
+    {
+        HeuristicSearch search(*this);
+        for (size_t i = next_root++; i < roots.size(); i = next_root++)
+        {
+            if (incremental)
+            {
+                heuristics.get_values(roots[i], tables[i]);
+                search.repair(tables[i], roots[i], changed_locations);
+            }
+            else
+            {
+                tables[i] = search.run(roots[i]);
+            }
+        }
+        num_expanded += search.num_expanded;
+    };
+    int threads_used = (int)min((size_t)max(num_threads, 1), max(roots.size(), (size_t)1));
+    vector<std::thread> threads;
+    for (int i = 1; i < threads_used; i++)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& thread : threads)
+        thread.join();
+
+    for (size_t i = 0; i < roots.size(); i++) // overwriting rows does not reorder the roots
+    {
+        heuristics.insert(roots[i], tables[i]);
+        tables[i] = vector<double>();
+    }
+
+    double runtime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << (incremental ? "Repaired " : "Recomputed ") << roots.size() << " heuristic tables after "
+        << changed_locations.size() << " locations changed (" << num_expanded << " expansions, " << runtime << " s)"
+        << std::endl;
+}
+
+
+bool BasicGraph::has_integral_weights() const
+{
+    for (double w : weights)
+    {
+        if (w < WEIGHT_MAX - 1 && w != std::floor(w))
+            return false;
+    }
+    return true;
 }
 
 
@@ -261,5 +696,6 @@ void BasicGraph::copy(const BasicGraph& copy)
 {
     rows = copy.get_rows();
     cols = copy.get_cols();
+    init_weights();
     weights = copy.get_weights();
 }
\ No newline at end of file
@@ -221,26 +221,13 @@ void BasicSystem::update_paths(const std::vector<Path>& MAPF_paths, int max_time
 
 void BasicSystem::update_initial_paths(vector<Path>& initial_paths) const
 {
+    // the low-level solvers check whether the paths still visit the goals and satisfy the constraints
     initial_paths.clear();
     initial_paths.resize(num_of_drives);
     for (int k = 0; k < num_of_drives; k++)
     {
-        // check whether the path traverse every goal locations
-        int i = (int)goal_locations[k].size() - 1;
-        int j = (int)paths[k].size() - 1;
-        while (i >= 0 && j >= 0)
-        {
-            while (j >= 0 && paths[k][j].location != goal_locations[k][i].first &&
-			paths[k][j].timestep >= goal_locations[k][i].second)
-                j--;
-            i--;
-        }
-        if (j < 0)
-            continue;
-          
-        if ((int) paths[k].size() <= timestep + planning_window)
+        if ((int) paths[k].size() <= timestep)
             continue;
-
         initial_paths[k].resize(paths[k].size() - timestep);
         for (int t = 0; t < (int)initial_paths[k].size(); t++)
         {
@@ -417,7 +404,7 @@ list<tuple<int, int, int>> BasicSystem::move()
             }
 
             // Check whether this move has conflicts with other agents
-			if (G.types[curr.location] != "Magic")
+			if (!G.is_type(curr.location, MAGIC))
 			{
 				for (int j = k + 1; j < num_of_drives; j++)
 				{
@@ -494,7 +481,7 @@ void BasicSystem::save_results()
         {
             output << task.first << "," << task.second << ",";
             if (task.second != 0)
-                output << G.heuristics.at(task.first)[prev];
+                output << G.heuristics.get(task.first, prev);
             output << ";";
             prev = task.first;
         }
@@ -522,6 +509,10 @@ void BasicSystem::save_results()
     saving_time = (std::clock() - t) / CLOCKS_PER_SEC;
 	if (screen)
 		std::cout << "Done! (" << saving_time << " s)" << std::endl;
+	if (screen && G.heuristics.is_lazy())
+		G.heuristics.print_cache_stats();
+	if (screen)
+		solver.path_planner.print_node_pool_stats();
 }
 
 
@@ -598,8 +589,7 @@ void BasicSystem::solve()
 		}
 		else
 		{
-			lra.resolve_conflicts(solver.solution);
-			update_paths(lra.solution);
+			resolve_conflicts_by_LRA(lra, solver.solution);
 		}
 	}
 	 else // PBS or ECBS
@@ -667,6 +657,8 @@ void BasicSystem::solve()
 		 }
 		 else
 		 {
+			 if (warm_start)
+				 update_initial_paths(solver.initial_paths);
 			 bool sol = solver.run(starts, goal_locations, time_limit);
 			 if (sol)
 			 {
@@ -676,8 +668,7 @@ void BasicSystem::solve()
 			 }
 			 else
 			 {
-				 lra.resolve_conflicts(solver.solution);
-				 update_paths(lra.solution);
+				 resolve_conflicts_by_LRA(lra, solver.solution);
 			 }
 		 }
 		 if (log)
@@ -688,12 +679,28 @@ void BasicSystem::solve()
 										+ std::to_string(num_of_drives) + "," + std::to_string(seed));
 }
 
+// A solver that failed before it had a path for every agent (e.g., its root node ran out of the low-level
+// budget) leaves some paths empty; those agents wait at their start locations.
+void BasicSystem::resolve_conflicts_by_LRA(LRAStar& lra, vector<Path> paths)
+{
+	paths.resize(starts.size());
+	for (int k = 0; k < (int)starts.size(); k++)
+	{
+		if (paths[k].empty())
+			paths[k].push_back(starts[k]);
+	}
+	lra.resolve_conflicts(paths);
+	update_paths(lra.solution);
+}
+
 bool BasicSystem::solve_by_WHCA(vector<Path>& planned_paths,
 	const vector<State>& new_starts, const vector< vector<pair<int, int> > >& new_goal_locations)
 {
 	WHCAStar whca(G, solver.path_planner);
     whca.k_robust = k_robust;
     whca.window = INT_MAX;
+    whca.commit_window = simulation_window;
+    whca.low_level_deadline = solver.low_level_deadline;
     whca.hold_endpoints = hold_endpoints || useDummyPaths;
     whca.screen = screen;
 	whca.initial_rt.hold_endpoints = true;
@@ -745,6 +752,7 @@ void BasicSystem::initialize_solvers()
 {
 	solver.k_robust = k_robust;
 	solver.window = planning_window;
+	solver.commit_window = simulation_window;
 	solver.hold_endpoints = hold_endpoints || useDummyPaths;
 	solver.screen = screen;
 
@@ -18,10 +18,7 @@ bool BeeGraph::load_map(string fname)
 	string temp;
 	myfile >> temp >> this->rows; // size
 	this->cols = this->rows;
-	move[0] = 1;
-	move[1] = -cols;
-	move[2] = -1;
-	move[3] = cols;
+	init_weights();
 	int num_of_obstacles;
 	myfile >> temp >> num_of_obstacles; // removes
 	int num_of_flowers;
@@ -72,20 +69,18 @@ bool BeeGraph::load_map(string fname)
 	}
 	types[entrance] = "Magic"; // vertex collsions at the Magic vertex are ignored!
 
-	this->weights.resize(rows * cols);
 	for (int i = 0; i < cols * rows; i++)
 	{
-		weights[i].resize(5, WEIGHT_MAX);
 		if (types[i] == "Obstacle")
 			continue;
 		else if (types[i] == "Magic")
-			weights[i][4] = wait_cost; //0; // waiting at the entrance has zero costs.
+			set_weight(i, 4, wait_cost); //0; // waiting at the entrance has zero costs.
 		else
-			weights[i][4] = wait_cost; // wait actions are allowed
+			set_weight(i, 4, wait_cost); // wait actions are allowed
 		for (int dir = 0; dir < 4; dir++)
 		{
 			if (0 <= i + move[dir] && i + move[dir] < cols * rows && get_Manhattan_distance(i, i + move[dir]) <= 1 && types[i + move[dir]] != "Obstacle")
-				weights[i][dir] = move_cost;
+				set_weight(i, dir, move_cost);
 		}
 	}
 
@@ -149,21 +144,16 @@ bool BeeGraph::load_Nathan_map(string fname)
 	beg = tok2.begin();
 	beg++;
 	this->cols = atoi((*beg).c_str()); // read number of cols
-	move[0] = 1;
-	move[1] = -cols;
-	move[2] = -1;
-	move[3] = cols;
+	init_weights();
 	getline(myfile, line); // skip word "map"
 
 	 //read tyeps and edge weights
 	this->types.resize(rows * cols);
-	this->weights.resize(rows * cols);
 	// read map (and start/goal locations)
 	for (int i = 0; i < rows; i++) {
 		getline(myfile, line);
 		for (int j = 0; j < cols; j++) {
 			int id = cols * i + j;
-			weights[id].resize(5, WEIGHT_MAX);
 			if (line[j] == '.')
 			{
 				this->types[id] = "Travel";
@@ -184,7 +174,7 @@ bool BeeGraph::load_Nathan_map(string fname)
 		for (int dir = 0; dir < 4; dir++)
 		{
 			if (0 <= i + move[dir] && i + move[dir] < cols * rows && get_Manhattan_distance(i, i + move[dir]) <= 1 && types[i + move[dir]] != "Obstacle")
-				weights[i][dir] = 1;
+				set_weight(i, dir, 1);
 		}
 	}
 	
@@ -201,7 +191,9 @@ void BeeGraph::preprocessing(string fname, bool consider_rotation)
 	// std::cout << "*** PreProcessing map ***" << std::endl;
 	clock_t t = std::clock();
 	this->consider_rotation = consider_rotation;
-	heuristics[entrance] = compute_heuristics(entrance);
+	build_neighbor_table();
+	build_cell_types();
+	vector<int> roots(1, entrance);
 	std::ifstream myfile((fname).c_str());
 	if (myfile.is_open())
 	{
@@ -217,14 +209,12 @@ void BeeGraph::preprocessing(string fname, bool consider_rotation)
 			while (iss >> id)
 			{
 				id--;
-				if (heuristics.find(flowers[id]) == heuristics.end())
-				{
-					heuristics[flowers[id]] = compute_heuristics(flowers[id]);
-				}
+				roots.push_back(flowers[id]);
 			}
 		}
 	}
 	myfile.close();
+	compute_heuristics_table(roots);
 
 	preprocessing_time = (std::clock() - t) * 1.0 / CLOCKS_PER_SEC;
 	// std::cout << heuristics.size() << " flowers!" << std::endl;
@@ -312,10 +312,10 @@ bool ECBS::find_path(ECBSNode* node, int agent)
         }
         curr = curr->parent;
     }
-	rt.copy(initial_rt);
+	rt.setBase(initial_rt);
     rt.build(paths, initial_constraints, constraints, agent);
 
-    path = path_planner.run(G, starts[agent], goal_locations[agent], rt);
+    path = plan_path(agent);
     rt.clear();
     LL_num_expanded += path_planner.num_expanded;
     LL_num_generated += path_planner.num_generated;
@@ -332,14 +332,16 @@ bool ECBS::find_path(ECBSNode* node, int agent)
         cout << path << endl;
         for (auto constraint : constraints)
             cout << constraint << endl;
-		rt.copy(initial_rt);
+		rt.setBase(initial_rt);
         rt.build(paths, list< tuple<int, int, int> >(), constraints, agent);
         path = path_planner.run(G, starts[agent], goal_locations[agent], rt);
         rt.clear();
         exit(-1);
     }
+    // the new constraints cannot lower the bound of the agent, while a partial path cannot raise it
+    double lower_bound = low_level_partial ? path_min_costs[agent] : path_planner.min_f_val;
     node->g_val = node->g_val - path_costs[agent] + path_planner.path_cost;
-    node->min_f_val = node->min_f_val - path_min_costs[agent] + path_planner.min_f_val;
+    node->min_f_val = node->min_f_val - path_min_costs[agent] + lower_bound;
     for (auto it = node->paths.begin(); it != node->paths.end(); ++it)
     {
         if (std::get<0>(*it) == agent)
@@ -348,7 +350,7 @@ bool ECBS::find_path(ECBSNode* node, int agent)
             break;
         }
     }
-    node->paths.emplace_back(agent, path, path_planner.min_f_val, path_planner.path_cost);
+    node->paths.emplace_back(agent, path, lower_bound, path_planner.path_cost);
     paths[agent] = &std::get<1>(node->paths.back());
     return true;
 }
@@ -443,9 +445,9 @@ bool ECBS::generate_root_node()
 
     for (int i = 0; i < num_of_agents; i++)
     {
-		rt.copy(initial_rt);
+		rt.setBase(initial_rt);
         rt.build(paths, initial_constraints, list<Constraint>(), i);
-        Path path = path_planner.run(G, starts[i], goal_locations[i], rt);
+        Path path = plan_path(i);
         /*if (path.empty() && hold_endpoints && goal_locations[i].size() == 1)
         {
 			goal_locations[i][0] = starts[i].location;
@@ -454,7 +456,10 @@ bool ECBS::generate_root_node()
 
 		if (path.empty())
 		{
-			std::cout << "NO SOLUTION EXISTS";
+			if (low_level_out_of_budget)
+				std::cout << "The low-level search ran out of its budget" << std::endl;
+			else
+				std::cout << "NO SOLUTION EXISTS";
 			return false;
         }
 
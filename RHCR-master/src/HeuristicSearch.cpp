@@ -0,0 +1,252 @@
+#include "HeuristicSearch.h"
+#include <algorithm>
+#include <functional>
+
+
+// weights up to this value are handled by the bucket queue
+const int MAX_BUCKET_WEIGHT = 1024;
+
+
+HeuristicSearch::HeuristicSearch(const BasicGraph& G): G(G)
+{
+    num_orientations = G.consider_rotation ? 4 : 1;
+    dist.resize((size_t)G.size() * num_orientations);
+
+    // pick the open list from the weights of the edges that the search can traverse
+    bool unit = true, integral = true;
+    double largest = 0;
+    auto check = [&](double w)
+    {
+        if (w != 1)
+            unit = false;
+        if (w < 0 || w > MAX_BUCKET_WEIGHT || w != (int)w)
+            integral = false;
+        largest = std::max(largest, w);
+    };
+    for (int loc = 0; loc < G.size(); loc++)
+    {
+        bool connected = false;
+        for (int i = 0; i < 4; i++)
+        {
+            int prev = loc - G.move[i];
+            if (G.valid_move(loc, i))
+                connected = true;
+            if (prev >= 0 && prev < G.size() && G.valid_move(prev, i))
+            {
+                connected = true;
+                check(G.get_weight(prev, loc));
+            }
+        }
+        if (G.consider_rotation && connected)
+            check(G.get_weight_in_direction(loc, 4)); // rotate
+    }
+
+    if (unit)
+        queue = FIFO;
+    else if (integral)
+        queue = BUCKET;
+    else
+        queue = HEAP;
+    max_weight = (int)largest;
+    if (queue == BUCKET)
+        buckets.resize(max_weight + 1);
+}
+
+
+template<class Relax>
+inline void HeuristicSearch::for_each_predecessor(int state, Relax relax) const
+{
+    State s(state / num_orientations, -1, G.consider_rotation ? state % num_orientations : -1);
+    for (const auto& neighbor : G.get_predecessors(s))
+        relax(G.get_state_index(neighbor.location, neighbor.orientation), neighbor.weight);
+}
+
+
+inline void HeuristicSearch::push(int state, double d, size_t& num_queued)
+{
+    dist[state] = d;
+    switch (queue)
+    {
+    case FIFO:
+        fifo.push_back(state);
+        break;
+    case BUCKET:
+        buckets[(int)d % (max_weight + 1)].push_back(state);
+        break;
+    case HEAP:
+        heap.emplace_back(d, state);
+        std::push_heap(heap.begin(), heap.end(), std::greater<pair<double, int> >());
+        break;
+    }
+    num_queued++;
+}
+
+
+std::vector<double> HeuristicSearch::run(int root_location, bool per_orientation)
+{
+    std::fill(dist.begin(), dist.end(), DBL_MAX);
+    size_t num_queued = 0;
+
+    // roots
+    if (G.consider_rotation && per_orientation)
+    {
+        // the goal test ignores orientations, so an agent at the root has arrived in any orientation
+        for (int o = 0; o < num_orientations; o++)
+            push(root_location * num_orientations + o, 0, num_queued);
+    }
+    else if (G.consider_rotation)
+    {
+        // the agent can arrive at the root in any orientation it can move into the root with
+        for (int i = 0; i < 4; i++)
+        {
+            int prev = root_location - G.move[i];
+            if (prev >= 0 && prev < G.size() && G.valid_move(prev, i))
+                push(root_location * num_orientations + G.get_direction(prev, root_location), 0, num_queued);
+        }
+    }
+    else
+    {
+        push(root_location, 0, num_queued);
+    }
+
+    if (queue == FIFO)
+    {
+        // every edge costs 1, so states are expanded in the order they are reached
+        for (size_t head = 0; head < fifo.size(); head++)
+        {
+            int curr = fifo[head];
+            double next_d = dist[curr] + 1;
+            num_expanded++;
+            for_each_predecessor(curr, [&](int next, double)
+            {
+                if (dist[next] == DBL_MAX)
+                    push(next, next_d, num_queued);
+            });
+        }
+        fifo.clear();
+    }
+    else if (queue == BUCKET)
+    {
+        // Dial's algorithm: the distances in the queue lie in [d, d + max_weight],
+        // so a circular array of max_weight + 1 buckets is enough
+        for (int d = 0; num_queued > 0; d++)
+        {
+            vector<int>& bucket = buckets[d % (max_weight + 1)];
+            while (!bucket.empty()) // zero-weight edges push into the current bucket
+            {
+                int curr = bucket.back();
+                bucket.pop_back();
+                num_queued--;
+                if (dist[curr] != d) // stale entry
+                    continue;
+                num_expanded++;
+                for_each_predecessor(curr, [&](int next, double w)
+                {
+                    if (d + w < dist[next])
+                        push(next, d + w, num_queued);
+                });
+            }
+        }
+    }
+    else
+    {
+        while (!heap.empty())
+        {
+            std::pop_heap(heap.begin(), heap.end(), std::greater<pair<double, int> >());
+            double d = heap.back().first;
+            int curr = heap.back().second;
+            heap.pop_back();
+            if (dist[curr] < d) // stale entry
+                continue;
+            num_expanded++;
+            for_each_predecessor(curr, [&](int next, double w)
+            {
+                if (d + w < dist[next])
+                    push(next, d + w, num_queued);
+            });
+        }
+    }
+
+    if (per_orientation)
+        return dist;
+
+    // the distance of a location is the smallest distance over its orientations
+    std::vector<double> res(G.size(), DBL_MAX);
+    for (int loc = 0; loc < G.size(); loc++)
+    {
+        for (int o = 0; o < num_orientations; o++)
+            res[loc] = std::min(res[loc], dist[loc * num_orientations + o]);
+    }
+    return res;
+}
+
+
+double HeuristicSearch::get_lookahead(const vector<double>& values, int state) const
+{
+    State s(state / num_orientations, -1, G.consider_rotation ? state % num_orientations : -1);
+    double best = DBL_MAX;
+    for (const auto& neighbor : G.get_successors(s))
+    {
+        int next = G.get_state_index(neighbor.location, neighbor.orientation);
+        if (next != state && values[next] != DBL_MAX) // waiting never shortens a path
+            best = std::min(best, values[next] + neighbor.weight);
+    }
+    return best;
+}
+
+
+// dist holds the one-step lookahead (rhs) of every state; a state is inconsistent if it differs from its value,
+// and inconsistent states are expanded in the order of min(value, rhs)
+void HeuristicSearch::repair(vector<double>& values, int root_location, const vector<int>& changed_locations)
+{
+    dist = values;
+    heap.clear();
+    auto is_root = [&](int state) { return state / num_orientations == root_location; };
+    auto update = [&](int state)
+    {
+        if (is_root(state))
+            return;
+        dist[state] = get_lookahead(values, state);
+        if (dist[state] != values[state])
+        {
+            heap.emplace_back(std::min(dist[state], values[state]), state);
+            std::push_heap(heap.begin(), heap.end(), std::greater<pair<double, int> >());
+        }
+    };
+
+    for (int loc : changed_locations)
+    {
+        for (int o = 0; o < num_orientations; o++)
+            update(loc * num_orientations + o);
+    }
+
+    while (!heap.empty())
+    {
+        std::pop_heap(heap.begin(), heap.end(), std::greater<pair<double, int> >());
+        double key = heap.back().first;
+        int curr = heap.back().second;
+        heap.pop_back();
+        if (dist[curr] == values[curr] || std::min(dist[curr], values[curr]) != key) // stale entry
+            continue;
+        num_expanded++;
+        if (dist[curr] < values[curr]) // the distance decreased, so it is final
+        {
+            values[curr] = dist[curr];
+            for_each_predecessor(curr, [&](int prev, double w)
+            {
+                if (!is_root(prev) && values[curr] + w < dist[prev])
+                {
+                    dist[prev] = values[curr] + w;
+                    heap.emplace_back(std::min(dist[prev], values[prev]), prev);
+                    std::push_heap(heap.begin(), heap.end(), std::greater<pair<double, int> >());
+                }
+            });
+        }
+        else // the distance increased, so the state and every state that may have reached the root through it are recomputed
+        {
+            values[curr] = DBL_MAX;
+            update(curr);
+            for_each_predecessor(curr, [&](int prev, double) { update(prev); });
+        }
+    }
+}
@@ -0,0 +1,423 @@
+#include "HeuristicTable.h"
+#include <algorithm>
+
+
+HeuristicTable::value_type HeuristicTable::get_required_type(const double* values, int num_values)
+{
+    value_type required = UINT16;
+    for (int i = 0; i < num_values; i++)
+    {
+        double v = values[i];
+        if (v == DBL_MAX)
+            continue;
+        if (required == UINT16 && (v < 0 || v >= UINT16_UNREACHABLE || v != (int)v))
+            required = FLOAT;
+        if (required == FLOAT && (double)(float)v != v)
+            return DOUBLE;
+    }
+    return required;
+}
+
+
+void HeuristicTable::widen(value_type new_type)
+{
+    if (new_type <= type)
+        return;
+    size_t n = roots.size() * row_size;
+    vector<double> values(n);
+    for (size_t i = 0; i < n; i++)
+        values[i] = get_value(i);
+    u16_values = vector<uint16_t>();
+    f32_values = vector<float>();
+    f64_values = vector<double>();
+    type = new_type;
+    if (type == FLOAT)
+    {
+        f32_values.resize(n);
+        for (size_t i = 0; i < n; i++)
+            f32_values[i] = encode<float>(values[i]);
+    }
+    else
+    {
+        f64_values = std::move(values);
+    }
+}
+
+
+void HeuristicTable::map(const vector<int>& roots, const void* values, value_type type, int row_size,
+                         std::shared_ptr<const void> mapping)
+{
+    clear();
+    this->row_size = row_size;
+    num_locations = row_size / num_orientations;
+    row_of.assign(num_locations, -1);
+    for (size_t i = 0; i < roots.size(); i++)
+        row_of[roots[i]] = (int)i;
+    this->roots = roots;
+    this->type = type;
+    mapped_values = values;
+    this->mapping = std::move(mapping);
+}
+
+
+void HeuristicTable::materialize()
+{
+    if (mapped_values == nullptr)
+        return;
+    switch (type)
+    {
+    case UINT16:
+        materialize_as<uint16_t>();
+        break;
+    case FLOAT:
+        materialize_as<float>();
+        break;
+    case DOUBLE:
+        materialize_as<double>();
+        break;
+    }
+    mapped_values = nullptr;
+    mapping.reset();
+}
+
+
+template<class Value>
+void HeuristicTable::materialize_as()
+{
+    const auto* values = static_cast<const Value*>(mapped_values);
+    get_storage<Value>().assign(values, values + roots.size() * row_size);
+}
+
+
+void HeuristicTable::insert(int root, const double* values, int num_values)
+{
+    materialize();
+    if (roots.empty())
+    {
+        row_size = num_values;
+        num_locations = num_values / num_orientations;
+        row_of.assign(num_locations, -1);
+    }
+    else if (num_values != row_size)
+    {
+        throw std::invalid_argument("the heuristics of location " + std::to_string(root) + " have the wrong size");
+    }
+    widen(get_required_type(values, num_values));
+
+    int row = row_of[root];
+    if (row < 0)
+    {
+        // evict the least recently used rows
+        while (lazy && roots.size() > num_pinned && roots.size() >= get_max_rows())
+            evict_row(lru_tail);
+        row = (int)roots.size();
+        row_of[root] = row;
+        roots.push_back(root);
+        if (lazy)
+        {
+            lru_prev.push_back(-1);
+            lru_next.push_back(-1);
+            lru_push_front(row);
+        }
+        u16_values.resize(type == UINT16 ? roots.size() * row_size : 0);
+        f32_values.resize(type == FLOAT ? roots.size() * row_size : 0);
+        f64_values.resize(type == DOUBLE ? roots.size() * row_size : 0);
+    }
+
+    else if (lazy)
+    {
+        touch(row);
+    }
+
+    size_t offset = (size_t)row * row_size;
+    for (int i = 0; i < row_size; i++)
+    {
+        switch (type)
+        {
+        case UINT16:
+            u16_values[offset + i] = encode<uint16_t>(values[i]);
+            break;
+        case FLOAT:
+            f32_values[offset + i] = encode<float>(values[i]);
+            break;
+        case DOUBLE:
+            f64_values[offset + i] = values[i];
+            break;
+        }
+    }
+}
+
+
+void HeuristicTable::set_num_orientations(int num_orientations)
+{
+    clear();
+    this->num_orientations = num_orientations;
+}
+
+
+void HeuristicTable::clear()
+{
+    num_locations = 0;
+    row_size = 0;
+    row_of.clear();
+    roots.clear();
+    lru_prev.clear();
+    lru_next.clear();
+    lru_head = lru_tail = -1;
+    type = UINT16;
+    u16_values = vector<uint16_t>();
+    f32_values = vector<float>();
+    f64_values = vector<double>();
+    mapped_values = nullptr;
+    mapping.reset();
+}
+
+
+void HeuristicTable::shrink_to_fit()
+{
+    u16_values.shrink_to_fit();
+    f32_values.shrink_to_fit();
+    f64_values.shrink_to_fit();
+    roots.shrink_to_fit();
+}
+
+
+void HeuristicTable::get_rows(const vector<int>& roots, vector<int>& rows)
+{
+    rows.resize(roots.size());
+    if (!lazy)
+    {
+        for (size_t i = 0; i < roots.size(); i++)
+            rows[i] = get_row(roots[i]);
+        return;
+    }
+    // the rows loaded so far are the most recently used ones, so pinning that many keeps them resident
+    num_pinned = 0;
+    for (size_t i = 0; i < roots.size(); i++)
+    {
+        get_row(roots[i]);
+        if (std::find(roots.begin(), roots.begin() + i, roots[i]) == roots.begin() + i)
+            num_pinned++;
+    }
+    num_pinned = 0;
+    for (size_t i = 0; i < roots.size(); i++) // loading a row can move the others
+        rows[i] = row_of[roots[i]];
+}
+
+
+HeuristicTable::value_type HeuristicTable::get_smallest_type() const
+{
+    value_type smallest = UINT16;
+    vector<double> values;
+    for (int root : roots)
+    {
+        get_values(root, values);
+        smallest = std::max(smallest, get_required_type(values.data(), (int)values.size()));
+    }
+    return smallest;
+}
+
+
+void HeuristicTable::get_values(int root, vector<double>& values) const
+{
+    if (!contains(root))
+        throw std::out_of_range("no heuristics for location " + std::to_string(root));
+    size_t offset = (size_t)row_of[root] * row_size;
+    values.resize(row_size);
+    for (int i = 0; i < row_size; i++)
+        values[i] = get_value(offset + i);
+}
+
+
+// the mapped pages are not counted, since they belong to the page cache
+size_t HeuristicTable::get_memory_usage() const
+{
+    return u16_values.capacity() * sizeof(uint16_t) + f32_values.capacity() * sizeof(float) +
+        f64_values.capacity() * sizeof(double) + (row_of.capacity() + roots.capacity()) * sizeof(int);
+}
+
+
+void HeuristicTable::set_lazy(int num_locations, std::function<vector<double>(int)> compute_row,
+                              size_t memory_budget, bool prefetching)
+{
+    clear();
+    lazy = true;
+    this->num_locations = num_locations;
+    row_size = num_locations * num_orientations;
+    row_of.assign(num_locations, -1);
+    this->compute_row = std::move(compute_row);
+    this->memory_budget = memory_budget;
+    if (prefetching && !prefetcher.joinable())
+    {
+        stopping = false;
+        prefetcher = std::thread(&HeuristicTable::run_prefetcher, this);
+    }
+}
+
+
+HeuristicTable::~HeuristicTable()
+{
+    stop_prefetching();
+}
+
+
+void HeuristicTable::stop_prefetching()
+{
+    if (!prefetcher.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        requests.clear();
+        stopping = true;
+    }
+    requested.notify_all();
+    prefetcher.join(); // after the row that it is computing, if any
+    queued.clear();
+    prefetched.clear();
+}
+
+
+size_t HeuristicTable::get_max_rows() const
+{
+    return std::max((size_t)1, memory_budget / (row_size * get_value_size(type)));
+}
+
+
+// The last row is moved into the evicted one, so that the matrix stays contiguous.
+void HeuristicTable::evict_row(int row)
+{
+    int last = (int)roots.size() - 1;
+    row_of[roots[row]] = -1;
+    lru_unlink(row);
+    if (row != last)
+    {
+        auto move_row = [&](auto& values)
+        {
+            std::copy(values.begin() + (size_t)last * row_size, values.begin() + (size_t)(last + 1) * row_size,
+                      values.begin() + (size_t)row * row_size);
+        };
+        switch (type)
+        {
+        case UINT16:
+            move_row(u16_values);
+            break;
+        case FLOAT:
+            move_row(f32_values);
+            break;
+        case DOUBLE:
+            move_row(f64_values);
+            break;
+        }
+        roots[row] = roots[last];
+        row_of[roots[row]] = row;
+        // relink the list entry of the last row at its new index
+        lru_prev[row] = lru_prev[last];
+        lru_next[row] = lru_next[last];
+        (lru_prev[row] >= 0 ? lru_next[lru_prev[row]] : lru_head) = row;
+        (lru_next[row] >= 0 ? lru_prev[lru_next[row]] : lru_tail) = row;
+    }
+    roots.pop_back();
+    lru_prev.pop_back();
+    lru_next.pop_back();
+    u16_values.resize(type == UINT16 ? roots.size() * row_size : 0);
+    f32_values.resize(type == FLOAT ? roots.size() * row_size : 0);
+    f64_values.resize(type == DOUBLE ? roots.size() * row_size : 0);
+    num_evictions++;
+}
+
+
+int HeuristicTable::load_row(int root)
+{
+    vector<double> values;
+    if (take_prefetched(root, values))
+    {
+        num_prefetch_hits++;
+    }
+    else
+    {
+        num_misses++;
+        values = compute_row(root);
+    }
+    insert(root, values);
+    return row_of[root];
+}
+
+
+bool HeuristicTable::take_prefetched(int root, vector<double>& values)
+{
+    if (!prefetcher.joinable())
+        return false;
+    std::unique_lock<std::mutex> lock(mutex);
+    if (computing == root) // it is almost done, so wait for it instead of computing it again
+        computed.wait(lock, [&]() { return computing != root; });
+    auto it = prefetched.find(root);
+    if (it != prefetched.end())
+    {
+        values = std::move(it->second);
+        prefetched.erase(it);
+        return true;
+    }
+    if (queued.erase(root) > 0) // the calling thread computes it now
+        requests.erase(std::find(requests.begin(), requests.end(), root));
+    return false;
+}
+
+
+void HeuristicTable::prefetch(int root)
+{
+    if (!prefetcher.joinable() || contains(root))
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // prefetched rows are not counted by the memory budget yet, so only keep a bounded number of them
+        if (queued.count(root) > 0 || prefetched.count(root) > 0 ||
+            queued.size() + prefetched.size() >= get_max_rows())
+            return;
+        requests.push_back(root);
+        queued.insert(root);
+    }
+    requested.notify_one();
+}
+
+
+void HeuristicTable::cancel_prefetching()
+{
+    if (!prefetcher.joinable())
+        return;
+    std::unique_lock<std::mutex> lock(mutex);
+    requests.clear();
+    if (computing >= 0) // wait until the background thread stops reading the graph
+        computed.wait(lock, [&]() { return computing < 0; });
+    queued.clear();
+    prefetched.clear();
+}
+
+
+void HeuristicTable::run_prefetcher()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        requested.wait(lock, [&]() { return stopping || !requests.empty(); });
+        if (stopping)
+            return;
+        int root = requests.front();
+        requests.pop_front();
+        computing = root;
+        lock.unlock();
+        vector<double> values = compute_row(root);
+        lock.lock();
+        computing = -1;
+        queued.erase(root);
+        prefetched[root] = std::move(values);
+        computed.notify_all();
+    }
+}
+
+
+void HeuristicTable::print_cache_stats() const
+{
+    std::cout << "Heuristics cache: " << num_hits << " hits, " << num_misses << " misses, "
+        << num_prefetch_hits << " prefetched, " << num_evictions << " evictions, "
+        << roots.size() << " resident tables (" << get_memory_usage() / 1048576.0 << " MB)" << std::endl;
+}
@@ -65,16 +65,12 @@ bool KivaGrid::load_weighted_map(std::string fname)
 	this->rows = atoi((*beg).c_str()); // read number of cols
 	beg++;
 	this->cols = atoi((*beg).c_str()); // read number of rows
-	move[0] = 1;
-	move[1] = -cols;
-	move[2] = -1;
-	move[3] = cols;
+	init_weights();
 
 	getline(myfile, line); // skip the headers
 
 	//read tyeps and edge weights
 	this->types.resize(rows * cols);
-	this->weights.resize(rows * cols);
 	for (int i = 0; i < rows * cols; i++)
 	{
 		getline(myfile, line);
@@ -89,13 +85,12 @@ bool KivaGrid::load_weighted_map(std::string fname)
 			this->endpoints.push_back(i);
 		beg++; // skip x
 		beg++; // skip y
-		weights[i].resize(5);
 		for (int j = 0; j < 5; j++) // read edge weights
 		{
 			if (std::string(beg->c_str()) == "inf")
-				weights[i][j] = WEIGHT_MAX;
+				set_weight(i, j, WEIGHT_MAX);
 			else
-				weights[i][j] = std::stod(beg->c_str());
+				set_weight(i, j, std::stod(beg->c_str()));
 			beg++;
 		}
 	}
@@ -135,10 +130,7 @@ bool KivaGrid::load_unweighted_map(std::string fname)
 	rows = atoi((*beg).c_str()); // read number of rows
 	beg++;
 	cols = atoi((*beg).c_str()); // read number of cols
-	move[0] = 1;
-	move[1] = -cols;
-	move[2] = -1;
-	move[3] = cols;
+	init_weights();
 
 	std::stringstream ss;
 	getline(myfile, line);
@@ -161,7 +153,6 @@ bool KivaGrid::load_unweighted_map(std::string fname)
 	//this->agents.resize(agent_num);
 	//endpoints.resize(num_endpoints + agent_num);
 	types.resize(rows * cols);
-	weights.resize(rows*cols);
 	//DeliverGoal.resize(row*col, false);
 	// read map
 	//int ep = 0, ag = 0;
@@ -173,7 +164,6 @@ bool KivaGrid::load_unweighted_map(std::string fname)
 		for (int j = 0; j < cols; j++)
 		{
 			int id = cols * i + j;
-			weights[id].resize(5, WEIGHT_MAX);
 			if (line[j] == '@') // obstacle
 			{
 				types[id] = "Obstacle";
@@ -181,21 +171,21 @@ bool KivaGrid::load_unweighted_map(std::string fname)
 			else if (line[j] == 'e') //endpoint
 			{
 				types[id] = "Endpoint";
-				weights[id][4] = 1;
+				set_weight(id, 4, 1);
 				endpoints.push_back(id);
 			}
 			else if (line[j] == 'r') //robot rest
 			{	//std::cout<<i<<" "<<j<<" "<<id<<endl;
 				//marker[id]++;
 				types[id] = "Home";
-				weights[id][4] = 1;
+				set_weight(id, 4, 1);
 				if(i>3 && i<29)
 				agent_home_locations.push_back(id);
 			}
 			else
 			{
 				types[id] = "Travel";
-				weights[id][4] = 1;
+				set_weight(id, 4, 1);
 			}
 		}
 	}
@@ -209,9 +199,9 @@ bool KivaGrid::load_unweighted_map(std::string fname)
 		for (int dir = 0; dir < 4; dir++)
 		{
 			if (0 <= i + move[dir] && i + move[dir] < cols * rows && get_Manhattan_distance(i, i + move[dir]) <= 1 && types[i + move[dir]] != "Obstacle")
-				weights[i][dir] = 1;
+				set_weight(i, dir, 1);
 			else
-				weights[i][dir] = WEIGHT_MAX;
+				set_weight(i, dir, WEIGHT_MAX);
 		}
 	}
 	
@@ -229,33 +219,17 @@ bool KivaGrid::load_unweighted_map(std::string fname)
 void KivaGrid::preprocessing(bool consider_rotation)
 {
 	std::cout << "*** PreProcessing map ***" << std::endl;
-	clock_t t = std::clock();
+	auto start = std::chrono::steady_clock::now();
 	this->consider_rotation = consider_rotation;
-	std::string fname;
-	if (consider_rotation)
-		fname = map_name + "_rotation_heuristics_table.txt";
-	else
-		fname = map_name + "_heuristics_table.txt";
-	std::ifstream myfile(fname.c_str());
-	bool succ = false;
-	if (myfile.is_open())
-	{
-		succ = load_heuristics_table(myfile);
-		myfile.close();
-	}
-	if (!succ)
-	{
-		for (auto endpoint : endpoints)
-		{
-			heuristics[endpoint] = compute_heuristics(endpoint);
-		}
-		for (auto home : agent_home_locations)
-		{
-			heuristics[home] = compute_heuristics(home);
-		}
-		save_heuristics_table(fname);
-	}
-
-	double runtime = (std::clock() - t) / CLOCKS_PER_SEC;
+	build_neighbor_table();
+	build_cell_types();
+	// pickup and dropoff locations are home stations too, and they are used as goals
+	vector<int> roots(endpoints);
+	roots.insert(roots.end(), agent_home_locations.begin(), agent_home_locations.end());
+	roots.insert(roots.end(), pickup_locations.begin(), pickup_locations.end());
+	roots.insert(roots.end(), dropoff_locations.begin(), dropoff_locations.end());
+	build_heuristics_table(roots);
+
+	double runtime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 	std::cout << "Done! (" << runtime << " s)" << std::endl;
 }
@@ -53,6 +53,19 @@ void KivaSystem::generate_zone_task_batch() {
 }
 
 
+// With lazy heuristics, the tables of the tasks that agents are likely to be assigned next
+// are computed on the background thread while the current window is being planned.
+void KivaSystem::prefetch_zone_tasks(int num_tasks) const {
+    if (!G.heuristics.is_lazy())
+        return;
+    for (int z = 0; z < (int)zone_task_batches.size(); z++) {
+        std::vector<int> tasks = queue_to_vector(z);
+        for (int i = 0; i < num_tasks && i < (int)tasks.size(); i++)
+            G.heuristics.prefetch(tasks[i]);
+    }
+}
+
+
 void KivaSystem::initialize() {
     initialize_solvers();
 
@@ -510,6 +523,7 @@ void KivaSystem::simulate(int simulation_time) {
 
         update_start_locations();
         update_goal_locations(capacity);
+        prefetch_zone_tasks(capacity);
         solve();
 
         auto new_finished = move();
@@ -52,7 +52,8 @@ Path LRAStar::find_shortest_path(const State& start, const vector<pair<int, int>
 	fibonacci_heap< StateTimeAStarNode*, compare<StateTimeAStarNode::compare_node> > open_list;
 	unordered_set< StateTimeAStarNode*, Hasher, EqNode> allNodes_table;
 	// generate start and add it to the OPEN list
-	double h_val = path_planner.compute_h_value(G, start.location, 0, goal_locations);
+	path_planner.set_goal_sequence(G, goal_locations);
+	double h_val = path_planner.get_h_value(G, start.location, 0, start.orientation);
 	auto root = new StateTimeAStarNode(start, 0, h_val, nullptr, 0);
 
 	num_generated++;
@@ -94,13 +95,14 @@ Path LRAStar::find_shortest_path(const State& start, const vector<pair<int, int>
 		{
 			travel_time += p->second;
 		}
-		for (const auto& next_state : G.get_neighbors(curr->state))
+		for (const auto& neighbor : G.get_successors(curr->state))
 		{
+			State next_state(neighbor.location, curr->state.timestep + 1, neighbor.orientation);
 			if (curr->state.location == next_state.location && curr->state.orientation == next_state.orientation)
 				continue;
 			// compute cost to next_id via curr node
-			double next_g_val = curr->g_val + G.get_weight(curr->state.location, next_state.location) * travel_time;
-			double next_h_val = path_planner.compute_h_value(G, next_state.location, curr->goal_id, goal_locations);
+			double next_g_val = curr->g_val + neighbor.weight * travel_time;
+			double next_h_val = path_planner.get_h_value(G, next_state.location, curr->goal_id, next_state.orientation);
 			if (next_h_val >= INT_MAX) // This vertex cannot reach the goal vertex
 				continue;
 
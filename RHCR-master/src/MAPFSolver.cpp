@@ -13,6 +13,24 @@ MAPFSolver::~MAPFSolver()
 {
 }
 
+Path MAPFSolver::plan_path(int agent)
+{
+	// a partial path is returned if the time runs out
+	path_planner.time_budget = low_level_deadline ?
+		max(time_limit - (double)(std::clock() - start) / CLOCKS_PER_SEC, 1e-6) : 0;
+	Path path;
+	if (agent < (int)initial_paths.size() && !initial_paths[agent].empty())
+		path = path_planner.replan(G, starts[agent], goal_locations[agent], rt, initial_paths[agent]);
+	else
+		path = path_planner.run(G, starts[agent], goal_locations[agent], rt);
+	low_level_partial = path_planner.partial_path && keep_partial_path(path);
+	low_level_out_of_budget = path_planner.partial_path && !low_level_partial;
+	if (low_level_out_of_budget)
+		return Path();
+	return path;
+}
+
+
 // TODO: implement validate_solution function
 bool MAPFSolver::validate_solution()
 {
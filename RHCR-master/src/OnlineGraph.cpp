@@ -28,16 +28,12 @@ bool OnlineGrid::load_map(std::string fname)
 	this->rows = atoi((*beg).c_str()); // read number of cols
 	beg++;
 	this->cols = atoi((*beg).c_str()); // read number of rows
-	move[0] = 1;
-	move[1] = -cols;
-	move[2] = -1;
-	move[3] = cols;
+	init_weights();
 
 	getline(myfile, line); // skip the headers
 
 	 //read tyeps and edge weights
 	this->types.resize(rows * cols);
-	this->weights.resize(rows * cols);
 	for (int i = 0; i < rows * cols; i++)
 	{
 		getline(myfile, line);
@@ -52,13 +48,12 @@ bool OnlineGrid::load_map(std::string fname)
 			this->exits.push_back(i);
 		beg++; // skip x
 		beg++; // skip y
-		weights[i].resize(5);
 		for (int j = 0; j < 5; j++) // read edge weights
 		{
 			if (std::string(beg->c_str()) == "inf")
-				weights[i][j] = WEIGHT_MAX;
+				set_weight(i, j, WEIGHT_MAX);
 			else
-				weights[i][j] = std::stod(beg->c_str());
+				set_weight(i, j, std::stod(beg->c_str()));
 			beg++;
 		}
 	}
@@ -74,29 +69,12 @@ bool OnlineGrid::load_map(std::string fname)
 void OnlineGrid::preprocessing(bool consider_rotation)
 {
 	std::cout << "*** PreProcessing map ***" << std::endl;
-	clock_t t = std::clock();
+	auto start = std::chrono::steady_clock::now();
 	this->consider_rotation = consider_rotation;
-	std::string fname;
-	if (consider_rotation)
-		fname = map_name + "_rotation_heuristics_table.txt";
-	else
-		fname = map_name + "_heuristics_table.txt";
-	std::ifstream myfile(fname.c_str());
-	bool succ = false;
-	if (myfile.is_open())
-	{
-		succ = load_heuristics_table(myfile);
-		myfile.close();
-	}
-	if (!succ)
-	{
-		for (auto exit : exits)
-		{
-			heuristics[exit] = compute_heuristics(exit);
-		}
-		save_heuristics_table(fname);
-	}
+	build_neighbor_table();
+	build_cell_types();
+	build_heuristics_table(exits);
 
-	double runtime = (std::clock() - t) / CLOCKS_PER_SEC;
+	double runtime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 	std::cout << "Done! (" << runtime << " s)" << std::endl;
 }
@@ -25,7 +25,7 @@ void OnlineSystem::update_start_and_goal_locations(int num_of_new_agents)
 	{
 		int loc = path[timestep].location;
 		starts.emplace_back(loc, 0, path[timestep].orientation);
-		if (G.types[loc] == "Entry")
+		if (G.is_type(loc, ENTRY))
 		{
 			available_entries.remove(loc);
 		}
@@ -47,7 +47,7 @@ void PBS::update_paths(PBSNode* curr)
         {
 		    if (!updated[std::get<0>(*p)])
 		    {
-			    paths[std::get<0>(*p)] = &(std::get<1>(*p));
+			    set_path(std::get<0>(*p), &(std::get<1>(*p)));
 			    updated[std::get<0>(*p)] = true;
 		    }
         }
@@ -98,7 +98,7 @@ void PBS::find_conflicts(list<Conflict>& conflicts, int a1, int a2)
 		{
 			int loc1 = paths[a1]->at(timestep).location;
 			int loc2 = paths[a2]->at(timestep).location;
-			if (loc1 == loc2 && G.types[loc1] != "Magic")
+			if (loc1 == loc2 && !G.is_type(loc1, MAGIC))
 			{
 				conflicts.emplace_back(a1, a2, loc1, -1, timestep);
 				return;
@@ -120,7 +120,7 @@ void PBS::find_conflicts(list<Conflict>& conflicts, int a1, int a2)
 			for (size_t timestep = min_path_length; timestep < paths[a2_]->size(); timestep++)
 			{
 				int loc2 = paths[a2_]->at(timestep).location;
-				if (loc1 == loc2 && G.types[loc1] != "Magic")
+				if (loc1 == loc2 && !G.is_type(loc1, MAGIC))
 				{
 					conflicts.emplace_back(a1_, a2_, loc1, -1, timestep); // It's at least a semi conflict		
 					return;
@@ -139,7 +139,7 @@ void PBS::find_conflicts(list<Conflict>& conflicts, int a1, int a2)
 			int loc = paths[a1]->at(timestep).location;
 			for (int i = max(0, timestep - k_robust); i <= min(timestep + k_robust, size2 - 1); i++)
 			{
-				if (loc == paths[a2]->at(i).location && G.types[loc] != "Magic")
+				if (loc == paths[a2]->at(i).location && !G.is_type(loc, MAGIC))
 				{
 					conflicts.emplace_back(a1, a2, loc, -1, min(i, timestep)); // k-robust vertex conflict
 					runtime_detect_conflicts += (double)(std::clock() - t) / CLOCKS_PER_SEC;
@@ -316,15 +316,13 @@ bool PBS::find_path(PBSNode* node, int agent)
     double path_cost;
 
     clock_t t = std::clock();
-	rt.copy(initial_rt);
-    rt.build(paths, initial_constraints, node->priorities.get_reachable_nodes(agent),
-             agent, starts[agent].location);
+    rt.update(paths, initial_constraints, node->priorities.get_reachable_nodes(agent), agent);
     runtime_get_higher_priority_agents += node->priorities.runtime;
 
     runtime_rt += (double)(std::clock() - t) / CLOCKS_PER_SEC;
 
     t = std::clock();
-    path = path_planner.run(G, starts[agent], goal_locations[agent], rt);
+    path = plan_path(agent);
 	runtime_plan_paths += (double)(std::clock() - t) / CLOCKS_PER_SEC;
     path_cost = path_planner.path_cost;
     // t = std::clock();
@@ -352,6 +350,7 @@ bool PBS::find_path(PBSNode* node, int agent)
         }
     }
     node->paths.emplace_back(agent, path);
+    rt.removePath(agent); // the new path can reuse the memory of the old one
     paths[agent] = &node->paths.back().second;
     return true;
 }
@@ -537,56 +536,40 @@ bool PBS::generate_root_node()
 	
 	// initialize paths_found_initially
 	paths.resize(num_of_agents, nullptr);
+	rt.setBase(initial_rt);
 	
     if (screen == 2)
         std::cout << "Generate root CT node ..." << std::endl;
 
     //dummy_start->priorities.copy(initial_priorities);
 
-    if (!initial_paths.empty())
-    {
-        for (int i = 0; i < num_of_agents; i++)
-        {
-            if (!initial_paths[i].empty())
-            {
-                dummy_start->paths.emplace_back(make_pair(i, initial_paths[i]));
-                paths[i] = &dummy_start->paths.back().second;
-                dummy_start->makespan = std::max(dummy_start->makespan, paths[i]->size() - 1);
-                dummy_start->g_val += get_path_cost(*paths[i]);
-            }
-        }
-    }
-
-
     for (int i = 0; i < num_of_agents; i++) 
 	{
-        if (paths[i] != nullptr)
-            continue;
         Path path;
         double path_cost;
-        int start_location  = starts[i].location;
         clock_t t = std::clock();
-		rt.copy(initial_rt);
-        rt.build(paths, initial_constraints, dummy_start->priorities.get_reachable_nodes(i), i, start_location);
+        rt.update(paths, initial_constraints, dummy_start->priorities.get_reachable_nodes(i), i);
         runtime_get_higher_priority_agents += dummy_start->priorities.runtime;
         runtime_rt += (double)(std::clock() - t) / CLOCKS_PER_SEC;
         vector< vector<double> > h_values(goal_locations[i].size());
         t = std::clock();
-        path = path_planner.run(G, starts[i], goal_locations[i], rt);
+        path = plan_path(i);
 		runtime_plan_paths += (double)(std::clock() - t) / CLOCKS_PER_SEC;
         path_cost = path_planner.path_cost;
-        rt.clear();
         LL_num_expanded += path_planner.num_expanded;
         LL_num_generated += path_planner.num_generated;
 
         if (path.empty())
         {
-            std::cout << "NO SOLUTION EXISTS";
+            if (low_level_out_of_budget)
+                std::cout << "The low-level search ran out of its budget" << std::endl;
+            else
+                std::cout << "NO SOLUTION EXISTS";
             return false;
         }
 
         dummy_start->paths.emplace_back(i, path);
-        paths[i] = &dummy_start->paths.back().second;
+        set_path(i, &dummy_start->paths.back().second);
         dummy_start->makespan = std::max(dummy_start->makespan, paths[i]->size() - 1);
         dummy_start->g_val += path_cost;
 	}
@@ -740,7 +723,8 @@ bool PBS::run(const vector<State>& starts,
 			    delete i;
 			    i = nullptr;
 		    }
-		    paths = copy;
+		    for (int a = 0; a < num_of_agents; a++)
+		        set_path(a, copy[a]);
         }
 
         if (!solution_found)
@@ -790,7 +774,7 @@ bool PBS::run(const vector<State>& starts,
         int start_loc = starts[i].location;
         for (const auto& goal : goal_locations[i])
         {
-            min_sum_of_costs += G.heuristics.at(goal.first)[start_loc];
+            min_sum_of_costs += G.heuristics.get(goal.first, start_loc);
             start_loc = goal.first;
         }
     }
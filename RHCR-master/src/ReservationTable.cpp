@@ -1,45 +1,257 @@
 #include "ReservationTable.h"
+#include <algorithm>
+
+void ReservationTable::allocateSlots()
+{
+	if (slots.size() != 6 * map_size) // map_size has been set or changed
+	{
+		dirty_slots.clear();
+		slots.assign(6 * map_size, Slot());
+	}
+}
+
+ReservationTable::Slot& ReservationTable::getSlot(size_t index)
+{
+	checkWritable();
+	allocateSlots();
+	Slot& slot = slots[index];
+	if (!slot.dirty)
+	{
+		slot.dirty = true;
+		dirty_slots.push_back(index);
+	}
+	return slot;
+}
+
+void ReservationTable::insertCT(size_t index, int t_min, int t_max)
+{
+	auto& slot = getSlot(index);
+	if (slot.sit_built)
+		resetSIT(slot);
+	auto it = slot.ct.end();
+	while (it != slot.ct.begin() && (it - 1)->first > t_min)
+		--it;
+	slot.ct.emplace(it, t_min, t_max);
+	if (recording != nullptr)
+		recording->push_back(Reference{index, t_min, t_max});
+}
+
+void ReservationTable::eraseCT(size_t index, int t_min, int t_max)
+{
+	checkWritable();
+	auto& slot = slots[index];
+	if (slot.sit_built)
+		resetSIT(slot);
+	auto it = std::find(slot.ct.begin(), slot.ct.end(), make_pair(t_min, t_max));
+	if (it != slot.ct.end())
+		slot.ct.erase(it);
+}
+
+void ReservationTable::clear()
+{
+	for (auto index : dirty_slots)
+	{
+		auto& slot = slots[index];
+		slot.ct.clear();
+		slot.sit.clear();
+		slot.sit_built = false;
+		slot.dirty = false;
+	}
+	dirty_slots.clear();
+	cat.clear();
+	cat_size = 0;
+	cat_words = 0;
+	references.clear();
+	reference_states.clear();
+	path_agents.clear();
+	excluded_agent = -1;
+	base = nullptr;
+	frozen = false;
+}
+
+void ReservationTable::copySlots(const ReservationTable& other)
+{
+	for (auto index : other.dirty_slots)
+	{
+		const auto& from = other.slots[index];
+		if (findSlot(index) == nullptr)
+		{
+			auto& to = getSlot(index);
+			to.ct = from.ct;
+		}
+		else
+		{
+			for (auto time_range : from.ct)
+				insertCT(index, time_range.first, time_range.second);
+		}
+		if (from.sit_built) // built from all layers of other
+		{
+			auto& to = getSlot(index);
+			to.sit = from.sit;
+			to.sit_built = true;
+		}
+	}
+	cat = other.cat;
+	cat_size = other.cat_size;
+	cat_words = other.cat_words;
+}
+
+void ReservationTable::copy(const ReservationTable& other)
+{
+	clear();
+	if (other.base != nullptr)
+		copySlots(*other.base);
+	copySlots(other);
+}
+
+void ReservationTable::setBase(const ReservationTable& other)
+{
+	clear();
+	if (other.base != nullptr) // share the base of other and copy its overlay
+	{
+		base = other.base;
+		copySlots(other);
+		return;
+	}
+	base = &other;
+	cat = other.cat;
+	cat_size = other.cat_size;
+	cat_words = other.cat_words;
+}
+
+void ReservationTable::setCAT(int location, int t_min, int t_max)
+{
+	if (t_min >= t_max)
+		return;
+	checkWritable();
+	uint64_t* words = &cat[location * cat_words];
+	int first = t_min >> 6, last = (t_max - 1) >> 6;
+	uint64_t first_mask = ~(uint64_t)0 << (t_min & 63);
+	uint64_t last_mask = ~(uint64_t)0 >> (63 - ((t_max - 1) & 63));
+	if (first == last)
+	{
+		words[first] |= first_mask & last_mask;
+		return;
+	}
+	words[first] |= first_mask;
+	for (int i = first + 1; i < last; i++)
+		words[i] = ~(uint64_t)0;
+	words[last] |= last_mask;
+}
+
+void ReservationTable::resizeCAT(int size)
+{
+	int words = (size + 63) >> 6;
+	checkWritable();
+	vector<uint64_t> resized(map_size * words, 0);
+	for (size_t loc = 0; loc < map_size && cat_size > 0; loc++)
+	{
+		for (int i = 0; i < min(words, cat_words); i++)
+			resized[loc * words + i] = cat[loc * cat_words + i];
+		if (size < cat_size && (size & 63)) // clear the timesteps beyond the new size
+			resized[loc * words + words - 1] &= ~(uint64_t)0 >> (64 - (size & 63));
+	}
+	cat.swap(resized);
+	cat_size = size;
+	cat_words = words;
+}
+
+size_t ReservationTable::getSlotKey(size_t index) const
+{
+	if (index < map_size)
+		return index;
+	auto edge = getEdge(index);
+	return (edge.first + 1) * map_size + edge.second;
+}
+
+size_t ReservationTable::getSlotIndex(size_t key) const
+{
+	if (key < map_size)
+		return key;
+	return getEdgeIndex((int)(key / map_size - 1), (int)(key % map_size));
+}
 
 // update SIT at the given location
 void ReservationTable::updateSIT(size_t location)
 {
-	if (sit.find(location) == sit.end())
+	if (location >= slots.size() || !slots[location].sit_built)
 	{
-		const auto& it = ct.find(location);
-		if (it != ct.end())
+		auto& slot = getSlot(location);
+		slot.sit_built = true;
+		slot.sit.emplace_back(0, INTERVAL_MAX, 0);
+		for (auto time_range : slot.ct)
+			insertConstraint2SIT(location, time_range.first, time_range.second);
+		if (const Slot* base_slot = findBaseSlot(location))
 		{
-			for (auto time_range : it->second)
+			for (auto time_range : base_slot->ct)
 				insertConstraint2SIT(location, time_range.first, time_range.second);
-			ct.erase(it);
 		}
 
-		if (location < map_size) // vertex
+		if (cat_size == 0)
+			return;
+		// the soft constraints are the set bits of the vertex, or, for an edge, the timesteps t
+		// at which its from location has conflicts at t and its to location has conflicts at t - 1
+		auto edge = location < map_size ? make_pair((int)location, -1) : getEdge(location);
+		const uint64_t* from = &cat[edge.first * cat_words];
+		const uint64_t* to = edge.second >= 0 ? &cat[edge.second * cat_words] : nullptr;
+		for (int i = 0; i < cat_words; i++)
 		{
-			for (int t = 0; t < (int)cat.size(); t++)
+			uint64_t word = from[i];
+			if (to != nullptr)
+				word &= (to[i] << 1) | (i > 0 ? to[i - 1] >> 63 : 0);
+			if (word == 0)
+				continue;
+			slot.sit.reserve(slot.sit.size() + 2 * __builtin_popcountll(word));
+			for (; word != 0; word &= word - 1)
 			{
-				if (cat[t][location])
-				{
-					insertSoftConstraint2SIT(location, t, t + 1);
-				}
-			}
-		}
-		else // edge
-		{
-			auto edge = getEdge(location);
-			for (int t = 1; t < (int)cat.size(); t++)
-			{
-				if (cat[t][edge.first] && cat[t - 1][edge.second])
-				{
-					insertSoftConstraint2SIT(location, t, t + 1);
-				}
+				int t = (i << 6) + __builtin_ctzll(word);
+				insertSoftConstraint2SIT(location, t, t + 1);
 			}
 		}
 	}
 }
 
+const vector<Interval>& ReservationTable::getSIT(size_t location)
+{
+	static const vector<Interval> default_sit(1, Interval(0, INTERVAL_MAX, 0));
+	if (!frozen)
+	{
+		updateSIT(location);
+		return slots[location].sit;
+	}
+	// the slots whose SIT is not built have neither constraints nor conflicts
+	return location < slots.size() && slots[location].sit_built ? slots[location].sit : default_sit;
+}
+
+void ReservationTable::freeze()
+{
+	if (frozen)
+		return;
+	if (G.heuristics.is_lazy()) // looking up a lazy table changes it
+		throw std::logic_error("a reservation table cannot be frozen with lazy heuristics");
+	// copy the indices, as updateSIT adds slots to dirty_slots
+	vector<size_t> indices(dirty_slots);
+	if (base != nullptr)
+		indices.insert(indices.end(), base->dirty_slots.begin(), base->dirty_slots.end());
+	for (auto index : indices)
+		updateSIT(index);
+
+	// a location or an edge has soft constraints only if its from location has conflicts
+	for (int loc = 0; loc < (int)map_size && cat_size > 0; loc++)
+	{
+		const uint64_t* words = &cat[loc * cat_words];
+		if (std::none_of(words, words + cat_words, [](uint64_t word) { return word != 0; }))
+			continue;
+		updateSIT(loc);
+		updateSIT(getEdgeIndex(loc, loc));
+		for (auto next : G.get_neighbors(loc))
+			updateSIT(getEdgeIndex(loc, next));
+	}
+	frozen = true;
+}
 
 //merge successive safe intervals with the same number of conflicts.
-void ReservationTable::mergeIntervals(list<Interval >& intervals) const
+void ReservationTable::mergeIntervals(vector<Interval >& intervals) const
 {
 	if (intervals.empty())
 		return;
@@ -65,13 +277,13 @@ void ReservationTable::mergeIntervals(list<Interval >& intervals) const
 
 int ReservationTable::getHoldingTimeFromSIT(int location)
 {
-	updateSIT(location);
-	if (sit.find(location) == sit.end())
-		return 0;
-	int t = std::get<1>(sit[location].back());
+	const auto& sit = getSIT(location);
+	if (sit.empty())
+		return INTERVAL_MAX;
+	int t = std::get<1>(sit.back());
 	if (t < INTERVAL_MAX)
 		return INTERVAL_MAX;
-	for (auto p = sit[location].rbegin(); p != sit[location].rend(); ++p)
+	for (auto p = sit.rbegin(); p != sit.rend(); ++p)
 	{
 		if (t == std::get<1>(*p))
 			t = std::get<0>(*p);
@@ -83,15 +295,16 @@ int ReservationTable::getHoldingTimeFromSIT(int location)
 
 int ReservationTable::getHoldingTimeFromCT(int location) const
 {
-	const auto& it = ct.find(location);
-	if (it == ct.end())
-		return 0;
-
 	int t = 0;
-	for (auto time_range : it->second)
+	for (const Slot* slot : {findSlot(location), findBaseSlot(location)})
 	{
-		if (time_range.second > t)
-			t = time_range.second;
+		if (slot == nullptr)
+			continue;
+		for (auto time_range : slot->ct)
+		{
+			if (time_range.second > t)
+				t = time_range.second;
+		}
 	}
 	return t;
 }
@@ -99,32 +312,54 @@ int ReservationTable::getHoldingTimeFromCT(int location) const
 set<int> ReservationTable::getConstrainedTimesteps(int location) const
 {
     set<int> rst;
-    const auto& it = ct.find(location);
-    if (it == ct.end())
-        return rst;
-
-    for (auto time_range : it->second)
+    for (const Slot* slot : {findSlot(location), findBaseSlot(location)})
     {
-        if (time_range.second == INTERVAL_MAX) // skip goal constraint
+        if (slot == nullptr)
             continue;
-        for (auto t = time_range.first; t < time_range.second; t++)
-            rst.insert(t);
+        for (auto time_range : slot->ct)
+        {
+            if (time_range.second == INTERVAL_MAX) // skip goal constraint
+                continue;
+            for (auto t = time_range.first; t < time_range.second; t++)
+                rst.insert(t);
+        }
     }
     return rst;
 }
 
+int ReservationTable::getLastConstrainedTimestep() const
+{
+	int t = cat_size - 1;
+	if (base != nullptr)
+		t = max(t, base->getLastConstrainedTimestep());
+	if (t == INT_MAX)
+		return INT_MAX;
+	for (auto index : dirty_slots)
+	{
+		const auto& slot = slots[index];
+		for (auto time_range : slot.ct)
+		{
+			if (time_range.second >= INTERVAL_MAX)
+				return INT_MAX;
+			t = max(t, time_range.second - 1);
+		}
+		if (!slot.sit_built)
+			continue;
+		// the last safe interval of every location starts after its last constraint
+		if (slot.sit.empty())
+			return INT_MAX;
+		const auto& last = slot.sit.back();
+		if (std::get<1>(last) < INTERVAL_MAX || std::get<2>(last))
+			return INT_MAX;
+		t = max(t, std::get<0>(last) - 1);
+	}
+	return t;
+}
+
 void ReservationTable::insertConstraint2SIT(int location, int t_min, int t_max)
 {
-    if (sit.find(location) == sit.end())
-    {
-        if (t_min > 0)
-        {
-			sit[location].emplace_back(0, t_min, 0);
-        }
-		sit[location].emplace_back(t_max, INTERVAL_MAX, 0);
-        return;
-    }
-    for (auto it = sit[location].begin(); it != sit[location].end();)
+    auto& sit = slots[location].sit;
+    for (auto it = sit.begin(); it != sit.end();)
     {
         if (t_min >= std::get<1>(*it))
 			++it; 
@@ -142,30 +377,22 @@ void ReservationTable::insertConstraint2SIT(int location, int t_min, int t_max)
         }
         else if (std::get<0>(*it) < t_min && t_max < std::get<1>(*it))
         {
-			sit[location].insert(it, make_tuple(std::get<0>(*it), t_min, 0));
+            int t0 = std::get<0>(*it);
             (*it) = make_tuple(t_max, std::get<1>(*it), 0);
+			sit.insert(it, make_tuple(t0, t_min, 0));
             break;
         }
         else // constraint_min <= get<0>(*it) && get<1> <= constraint_max
         {
-            it = sit[location].erase(it);
+            it = sit.erase(it);
         }
     }
 }
 
 void ReservationTable::insertSoftConstraint2SIT(int location, int t_min, int t_max)
 {
-    if (sit.find(location) == sit.end())
-    {
-        if (t_min > 0)
-        {
-			sit[location].emplace_back(0, t_min, false);
-        }
-		sit[location].emplace_back(t_min, t_max, true);
-		sit[location].emplace_back(t_max, INTERVAL_MAX, false);
-        return;
-    }
-    for (auto it = sit[location].begin(); it != sit[location].end(); it++)
+    auto& sit = slots[location].sit;
+    for (auto it = sit.begin(); it != sit.end(); ++it)
     {
         if (t_min >= std::get<1>(*it))
             continue;
@@ -174,21 +401,24 @@ void ReservationTable::insertSoftConstraint2SIT(int location, int t_min, int t_m
 		else if (std::get<2>(*it)) // the interval already has conflicts. No need to update
 			continue;
 
+        // vector::insert invalidates it, so the intervals before it are inserted last
         if (std::get<0>(*it) < t_min && std::get<1>(*it) <= t_max)
         {
-			sit[location].insert(it, make_tuple(std::get<0>(*it), t_min, false));
+            int t0 = std::get<0>(*it);
 			(*it) = make_tuple(t_min, std::get<1>(*it), true);
+			it = sit.insert(it, make_tuple(t0, t_min, false)) + 1;
         }
         else if (t_min <= std::get<0>(*it) && t_max < std::get<1>(*it))
         {
-			sit[location].insert(it, make_tuple(std::get<0>(*it), t_max, true));
+            int t0 = std::get<0>(*it);
             (*it) = make_tuple(t_max, std::get<1>(*it), false);
+			it = sit.insert(it, make_tuple(t0, t_max, true)) + 1;
         }
         else if (std::get<0>(*it) < t_min && t_max < std::get<1>(*it))
         {
-			sit[location].insert(it, make_tuple(std::get<0>(*it), t_min, false));
-			sit[location].insert(it, make_tuple(t_min, t_max,  true));
+            int t0 = std::get<0>(*it);
             (*it) = make_tuple(t_max, std::get<1>(*it), false);
+			it = sit.insert(it, {make_tuple(t0, t_min, false), make_tuple(t_min, t_max,  true)}) + 2;
         }
         else // constraint_min <= get<0>(*it) && get<1> <= constraint_max
         {
@@ -200,6 +430,7 @@ void ReservationTable::insertSoftConstraint2SIT(int location, int t_min, int t_m
 
 void ReservationTable::insertPath2CT(const Path& path)
 {
+	checkWritable();
 	if (path.empty())
 		return;
 	auto prev = path.begin();
@@ -209,11 +440,11 @@ void ReservationTable::insertPath2CT(const Path& path)
 	{
 		if (prev->location != curr->location)
 		{
-			if (G.types[prev->location] != "Magic")
-				ct[prev->location].emplace_back(prev->timestep - k_robust, curr->timestep + k_robust);
+			if (!G.is_type(prev->location, MAGIC))
+				insertCT(prev->location, prev->timestep - k_robust, curr->timestep + k_robust);
 			if (k_robust == 0) // add edge constraint
 			{
-				ct[getEdgeIndex(curr->location, prev->location)].emplace_back(curr->timestep, curr->timestep + 1);
+				insertCT(getEdgeIndex(curr->location, prev->location), curr->timestep, curr->timestep + 1);
 			}
 			prev = curr;
 		}
@@ -221,33 +452,33 @@ void ReservationTable::insertPath2CT(const Path& path)
 	}
 	if (curr != path.end())
 	{
-		if (G.types[prev->location] != "Magic")
-			ct[prev->location].emplace_back(prev->timestep - k_robust, curr->timestep + k_robust);
+		if (!G.is_type(prev->location, MAGIC))
+			insertCT(prev->location, prev->timestep - k_robust, curr->timestep + k_robust);
 		if (k_robust == 0) // add edge constraint
 		{
-			ct[getEdgeIndex(curr->location, prev->location)].emplace_back(curr->timestep, curr->timestep + 1);
+			insertCT(getEdgeIndex(curr->location, prev->location), curr->timestep, curr->timestep + 1);
 		}
 	}
 	else
 	{
-		if (G.types[prev->location] != "Magic")
-			ct[prev->location].emplace_back(prev->timestep - k_robust, path.back().timestep + 1 + k_robust);
+		if (!G.is_type(prev->location, MAGIC))
+			insertCT(prev->location, prev->timestep - k_robust, path.back().timestep + 1 + k_robust);
 		if (k_robust == 0) // add edge constraint
 		{
-			ct[getEdgeIndex(path.back().location, prev->location)].emplace_back(path.back().timestep, path.back().timestep + 1);
+			insertCT(getEdgeIndex(path.back().location, prev->location), path.back().timestep, path.back().timestep + 1);
 		}
 	}
-	if (hold_endpoints && G.types[prev->location] != "Magic")
-		ct[path.back().location].emplace_back(path.back().timestep, INTERVAL_MAX);
+	if (hold_endpoints && !G.is_type(prev->location, MAGIC))
+		insertCT(path.back().location, path.back().timestep, INTERVAL_MAX);
 }
 
 void ReservationTable::addInitialConstraints(const list< tuple<int, int, int> >& initial_constraints, int current_agent)
 {
 	for (auto con : initial_constraints)
 	{
-		if (std::get<0>(con) != current_agent && 0 <= std::get<1>(con) && std::get<1>(con) < G.types.size() &&
-			G.types[std::get<1>(con)] != "Magic")
-			ct[std::get<1>(con)].emplace_back(0, min(window, std::get<2>(con)));
+		if (std::get<0>(con) != current_agent && 0 <= std::get<1>(con) && std::get<1>(con) < G.size() &&
+			!G.is_type(std::get<1>(con), MAGIC))
+			insertCT(std::get<1>(con), 0, min(window, std::get<2>(con)));
 	}
 }
 
@@ -262,23 +493,14 @@ void ReservationTable::insertPath2CAT(const Path& path)
 	while (timestep <= max_timestep)
 	{
 		int location = path[timestep].location;
-		if (G.types[location] != "Magic")
+		if (!G.is_type(location, MAGIC))
 		{
-			for (int t = max(0, timestep - k_robust); t <= min((int)cat.size() - 1, timestep + k_robust); t++)
-			{
-				cat[t][location] = true;
-			}
+			setCAT(location, max(0, timestep - k_robust), min(cat_size, timestep + k_robust + 1));
 		}
 		timestep++;
 	}
-	if (G.types[path.back().location] != "Magic")
-	{
-		while (timestep < (int)cat.size()) // assume that the agent waits at its last location
-		{
-			cat[timestep][path.back().location] = true;
-			timestep++;
-		}
-	}
+	if (!G.is_type(path.back().location, MAGIC)) // assume that the agent waits at its last location
+		setCAT(path.back().location, timestep, cat_size);
 }
 
 // For PBS
@@ -286,6 +508,7 @@ void ReservationTable::build(const vector<Path*>& paths,
         const list< tuple<int, int, int> >& initial_constraints,
         const unordered_set<int>& high_priority_agents, int current_agent, int start_location)
 {
+    checkWritable();
     clock_t t = std::clock();
 
     // add hard constraints
@@ -321,11 +544,144 @@ void ReservationTable::build(const vector<Path*>& paths,
     runtime = (std::clock() - t) * 1.0  / CLOCKS_PER_SEC;
 }
 
+// For PBS
+void ReservationTable::update(const vector<Path*>& paths,
+        const list< tuple<int, int, int> >& initial_constraints,
+        const unordered_set<int>& high_priority_agents, int current_agent)
+{
+    checkWritable();
+    clock_t t = std::clock();
+    int num_of_owners = 3 * num_of_agents + 1;
+    if ((int)references.size() != num_of_owners) // the first update after clear
+    {
+        references.assign(num_of_owners, vector<Reference>());
+        reference_states.assign(num_of_owners, UNKNOWN);
+        for (auto con : initial_constraints) // initial constraints do not change until the table is cleared
+        {
+            int agent = std::get<0>(con);
+            int owner = 0 <= agent && agent < num_of_agents ? 2 * num_of_agents + agent : 3 * num_of_agents;
+            if (std::get<1>(con) < 0 || std::get<1>(con) >= G.size() || G.is_type(std::get<1>(con), MAGIC))
+                continue;
+            recording = &references[owner];
+            insertCT(std::get<1>(con), 0, min(window, std::get<2>(con)));
+            recording = nullptr;
+        }
+        for (int owner = 2 * num_of_agents; owner < num_of_owners; owner++)
+            reference_states[owner] = IN_CT;
+    }
+
+    // the agent does not conflict with its own start reservation and initial constraints
+    if (excluded_agent != current_agent)
+    {
+        if (excluded_agent >= 0)
+            insertReferences(2 * num_of_agents + excluded_agent);
+        eraseReferences(2 * num_of_agents + current_agent);
+        excluded_agent = current_agent;
+    }
+    if (prioritize_start)
+    {
+        for (int i = 0; i < num_of_agents; i++)
+        {
+            if (i == current_agent || paths[i] == nullptr)
+                continue;
+            if (reference_states[num_of_agents + i] == UNKNOWN)
+            {
+                recording = &references[num_of_agents + i];
+                insertConstraints4start(*paths[i]);
+                recording = nullptr;
+                reference_states[num_of_agents + i] = IN_CT;
+            }
+            else
+                insertReferences(num_of_agents + i);
+        }
+        eraseReferences(num_of_agents + current_agent);
+    }
+
+    // add hard constraints
+    vector<bool> soft(num_of_agents, true);
+    for (auto i : path_agents)
+    {
+        if (high_priority_agents.find(i) == high_priority_agents.end())
+            eraseReferences(i);
+    }
+    path_agents.clear();
+    for (auto i : high_priority_agents)
+    {
+        if (paths[i] == nullptr)
+            continue;
+        if (reference_states[i] == UNKNOWN)
+            addPath(i, *paths[i]);
+        else
+            insertReferences(i);
+        path_agents.push_back(i);
+        soft[i] = false;
+    }
+
+    runtime = (std::clock() - t) * 1.0  / CLOCKS_PER_SEC;
+    if (!use_cat)
+        return;
+
+    // add soft constraints; the CAT is rebuilt, so the SIT of every slot becomes outdated
+    for (auto index : dirty_slots)
+        resetSIT(slots[index]);
+    std::fill(cat.begin(), cat.end(), 0);
+    soft[current_agent] = false;
+    for (int i = 0; i < num_of_agents; i++)
+    {
+        if(!soft[i] || paths[i] == nullptr)
+            continue;
+		insertPath2CAT(*paths[i]);
+    }
+
+    runtime = (std::clock() - t) * 1.0  / CLOCKS_PER_SEC;
+}
+
+void ReservationTable::addPath(int agent, const Path& path)
+{
+	checkWritable();
+    recording = &references[agent];
+    insertPath2CT(path);
+    recording = nullptr;
+    reference_states[agent] = IN_CT;
+}
+
+void ReservationTable::removePath(int agent)
+{
+	checkWritable();
+    if (agent >= (int)references.size()) // update has not been called
+        return;
+    for (int owner : {agent, num_of_agents + agent}) // the start reservation depends on the path
+    {
+        eraseReferences(owner);
+        references[owner].clear();
+        reference_states[owner] = UNKNOWN;
+    }
+}
+
+void ReservationTable::insertReferences(int owner)
+{
+    if (reference_states[owner] != OUT_OF_CT)
+        return;
+    for (const auto& reference : references[owner])
+        insertCT(reference.slot, reference.t_min, reference.t_max);
+    reference_states[owner] = IN_CT;
+}
+
+void ReservationTable::eraseReferences(int owner)
+{
+    if (reference_states[owner] != IN_CT)
+        return;
+    for (const auto& reference : references[owner])
+        eraseCT(reference.slot, reference.t_min, reference.t_max);
+    reference_states[owner] = OUT_OF_CT;
+}
+
 // For WHCA*
 void ReservationTable::build(const vector<Path>& paths,
                             const list< tuple<int, int, int> >& initial_constraints,
                             int current_agent)
 {
+    checkWritable();
     clock_t t = std::clock();
     // add hard constraints
     for (int i = 0; i < (int)paths.size(); i++)
@@ -344,6 +700,7 @@ void ReservationTable::build(const vector<Path*>& paths,
                             const list< tuple<int, int, int> >& initial_constraints,
                             const list< Constraint >& hard_constraints, int current_agent)
 {
+    checkWritable();
     clock_t t = std::clock();
     // add hard constraints
     for (auto con : hard_constraints)
@@ -353,13 +710,14 @@ void ReservationTable::build(const vector<Path*>& paths,
            // insert_positive_constraint(std::get<1>(con), std::get<3>(con));
 		   // TODO: insert positive constraints
         }
-		else if (std::get<2>(con) < 0 && G.types[std::get<1>(con)] != "Magic") // vertex constraint
+		else if (std::get<2>(con) < 0) // vertex constraint
         {
-			ct[std::get<1>(con)].emplace_back(std::get<3>(con), std::get<3>(con) + 1);
+			if (!G.is_type(std::get<1>(con), MAGIC))
+				insertCT(std::get<1>(con), std::get<3>(con), std::get<3>(con) + 1);
         }
 		else // edge constraint
 		{
-			ct[getEdgeIndex(std::get<1>(con), std::get<2>(con))].emplace_back(std::get<3>(con), std::get<3>(con) + 1);
+			insertCT(getEdgeIndex(std::get<1>(con), std::get<2>(con)), std::get<3>(con), std::get<3>(con) + 1);
 		}
     }
 
@@ -367,7 +725,7 @@ void ReservationTable::build(const vector<Path*>& paths,
 
     /* add soft constraints */
 	// compute the max timestep that cat needs
-	size_t cat_size = 0;
+	size_t max_size = 0;
     for (int i = 0; i < num_of_agents; i++)
     {
         if(i == current_agent || paths[i] == nullptr)
@@ -375,13 +733,13 @@ void ReservationTable::build(const vector<Path*>& paths,
 
 		if ((int)paths[i]->size() > window)
 		{
-			cat_size = window;
+			max_size = window;
 			break;
 		}
-		else if (cat_size < paths[i]->size())
-			cat_size = paths[i]->size();
+		else if (max_size < paths[i]->size())
+			max_size = paths[i]->size();
 	}
-	cat.resize(cat_size, vector<bool>(map_size));
+	resizeCAT((int)max_size);
 
 	// build cat
 	for (int i = 0; i < num_of_agents; i++)
@@ -403,20 +761,25 @@ void ReservationTable::insertConstraints4starts(const vector<Path*>& paths, int
             continue;
         else if (i != current_agent)// prohibit the agent from conflicting with other agents at their start locations
         {
-            int start = paths[i]->front().location;
-            if (start < 0 || G.types[start] == "Magic")
-                continue;
-            for (auto state : (*paths[i]))
-            {
-                if (state.location != start) // The agent starts to move
-                {
-                    // The agent waits at its start locations between [appear_time, state.timestep - 1]
-                    // So other agents cannot use this start location between
-                    // [appear_time - k_robust, state.timestep + k_robust - 1]
-                    ct[start].emplace_back(0, state.timestep + k_robust);
-                    break;
-                }
-            }
+            insertConstraints4start(*paths[i]);
+        }
+    }
+}
+
+void ReservationTable::insertConstraints4start(const Path& path)
+{
+    int start = path.front().location;
+    if (start < 0 || G.is_type(start, MAGIC))
+        return;
+    for (auto state : path)
+    {
+        if (state.location != start) // The agent starts to move
+        {
+            // The agent waits at its start locations between [appear_time, state.timestep - 1]
+            // So other agents cannot use this start location between
+            // [appear_time - k_robust, state.timestep + k_robust - 1]
+            insertCT(start, 0, state.timestep + k_robust);
+            break;
         }
     }
 }
@@ -428,16 +791,7 @@ list<Interval> ReservationTable::getSafeIntervals(int location, int lower_bound,
     if (lower_bound >= upper_bound)
         return safe_intervals;
 
-	updateSIT(location);
-	
-	auto it = sit.find(location);
-    if (it == sit.end()) 
-    {
-		safe_intervals.emplace_back(0, INTERVAL_MAX, 0);
-		return safe_intervals;
-    }
-
-    for(auto interval : it->second)
+    for(auto interval : getSIT(location))
     {
         if (lower_bound >= std::get<1>(interval))
             continue;
@@ -480,26 +834,13 @@ list<Interval> ReservationTable::getSafeIntervals(int from, int to, int lower_bo
 
 Interval ReservationTable::getFirstSafeInterval(int location)
 {
-	updateSIT(location);
-    auto it = sit.find(location);
-    if (it == sit.end())
-    {
-		return Interval(0, INTERVAL_MAX, 0);
-    }
-    return it->second.front();
+    return getSIT(location).front();
 }
 
 // find a safe interval with t_min as given
 bool ReservationTable::findSafeInterval(Interval& interval, int location, int t_min)
 {
-	updateSIT(location);
-
-    auto it = sit.find(location);
-    if (it == sit.end())
-    {
-		return t_min == 0;
-    }
-    for( auto i : it->second)
+    for( auto i : getSIT(location))
     {
         if (t_min == std::get<0>(i))
         {
@@ -515,10 +856,12 @@ bool ReservationTable::findSafeInterval(Interval& interval, int location, int t_
 
 void ReservationTable::print() const
 {
-    for (const auto& entry : sit)
+    for (auto index : dirty_slots)
     {
-        cout << "loc=" << entry.first << ":";
-        for (const auto& interval : entry.second)
+        if (!slots[index].sit_built)
+            continue;
+        cout << "loc=" << getSlotKey(index) << ":";
+        for (const auto& interval : slots[index].sit)
         {
             cout << "[" << std::get<0>(interval) << "," << std::get<1>(interval) << "],";
         }
@@ -529,38 +872,45 @@ void ReservationTable::print() const
 void ReservationTable::printCT(size_t location) const
 {
     cout << "loc=" << location << ":";
-    const auto it = ct.find(location);
-    if (it != ct.end())
+    for (const Slot* slot : {findSlot(location), findBaseSlot(location)})
     {
-        for (const auto & interval : ct.at(location))
+        if (slot == nullptr)
+            continue;
+        for (const auto & interval : slot->ct)
         cout << "[" << std::get<0>(interval) << "," << std::get<1>(interval) << "],";
     }
     cout << endl;
 }
 
 
+// the time ranges are sorted by t_min, so the scan stops at the first one that starts after t
+static inline bool isInTimeRanges(const vector<pair<int, int> >& time_ranges, int t)
+{
+	for (auto time_range : time_ranges)
+	{
+		if (t < time_range.first)
+			break;
+		if (t < time_range.second)
+			return true;
+	}
+	return false;
+}
+
 bool ReservationTable::isConstrained(int curr_id, int next_id, int next_timestep) const
 {
-	auto it = ct.find(next_id);
-	if (it != ct.end())
+	for (const Slot* slot : {findSlot(next_id), findBaseSlot(next_id)})
 	{
-		for (auto time_range : it->second)
-		{
-			if (next_timestep >= time_range.first && next_timestep < time_range.second)
-				return true;
-		}
+		if (slot != nullptr && isInTimeRanges(slot->ct, next_timestep))
+			return true;
 	}
 
 	if (curr_id != next_id)
 	{
-		it = ct.find(getEdgeIndex(curr_id, next_id));
-		if (it != ct.end())
+		size_t edge = getEdgeIndex(curr_id, next_id);
+		for (const Slot* slot : {findSlot(edge), findBaseSlot(edge)})
 		{
-			for (auto time_range : it->second)
-			{
-				if (next_timestep >= time_range.first && next_timestep < time_range.second)
-					return true;
-			}
+			if (slot != nullptr && isInTimeRanges(slot->ct, next_timestep))
+				return true;
 		}
 	}
 	return false;
@@ -569,17 +919,132 @@ bool ReservationTable::isConstrained(int curr_id, int next_id, int next_timestep
 
 bool ReservationTable::isConflicting(int curr_id, int next_id, int next_timestep) const
 {
-	if (next_timestep >= (int)cat.size())
+	if (next_timestep >= cat_size)
 		return false;
 
 	// check vertex constraints (being in next_id at next_timestep is disallowed)
-	if (cat[next_timestep][next_id])
+	if (getCAT(next_id, next_timestep))
 		return true;
 	// check edge constraints (the move from curr_id to next_id at next_timestep-1 is disallowed)
 	// which means that res_table is occupied with another agent for [curr_id,next_timestep] and [next_id,next_timestep-1]
 	// WRONG!
-	else if (curr_id != next_id && cat[next_timestep][curr_id] && cat[next_timestep - 1][next_id])
+	else if (curr_id != next_id && getCAT(curr_id, next_timestep) && getCAT(next_id, next_timestep - 1))
 		return true;
 	else
 		return false;
-}
\ No newline at end of file
+}
+
+
+void ReservationTable::save(ostream& os) const
+{
+	if (base != nullptr) // save both layers as one table
+	{
+		ReservationTable flat(G);
+		flat.map_size = map_size;
+		flat.num_of_agents = num_of_agents;
+		flat.k_robust = k_robust;
+		flat.window = window;
+		flat.use_cat = use_cat;
+		flat.hold_endpoints = hold_endpoints;
+		flat.prioritize_start = prioritize_start;
+		flat.copy(*this);
+		flat.save(os);
+		return;
+	}
+	os << "rt " << map_size << " " << num_of_agents << " " << k_robust << " " << window << " " << use_cat << " "
+		<< hold_endpoints << " " << prioritize_start << endl;
+	int num_ct = 0, num_sit = 0;
+	for (auto index : dirty_slots)
+	{
+		num_ct += !slots[index].ct.empty();
+		num_sit += slots[index].sit_built;
+	}
+	os << "ct " << num_ct;
+	for (auto index : dirty_slots)
+	{
+		const auto& time_ranges = slots[index].ct;
+		if (time_ranges.empty())
+			continue;
+		os << " " << getSlotKey(index) << " " << time_ranges.size();
+		for (const auto& time_range : time_ranges)
+			os << " " << time_range.first << " " << time_range.second;
+	}
+	os << endl << "cat " << cat_size;
+	for (int t = 0; t < cat_size; t++)
+	{
+		vector<int> locations;
+		for (size_t loc = 0; loc < map_size; loc++)
+		{
+			if (getCAT((int)loc, t))
+				locations.push_back((int)loc);
+		}
+		os << " " << locations.size();
+		for (int loc : locations)
+			os << " " << loc;
+	}
+	os << endl << "sit " << num_sit;
+	for (auto index : dirty_slots)
+	{
+		if (!slots[index].sit_built)
+			continue;
+		os << " " << getSlotKey(index) << " " << slots[index].sit.size();
+		for (const auto& interval : slots[index].sit)
+			os << " " << std::get<0>(interval) << " " << std::get<1>(interval) << " " << std::get<2>(interval);
+	}
+	os << endl;
+}
+
+
+bool ReservationTable::load(std::istream& is)
+{
+	clear();
+	string tag;
+	size_t n, m;
+	if (!(is >> tag >> map_size >> num_of_agents >> k_robust >> window >> use_cat >> hold_endpoints >> prioritize_start) ||
+		tag != "rt")
+		return false;
+	allocateSlots(); // here rather than in the first search on the table
+	if (!(is >> tag >> n) || tag != "ct")
+		return false;
+	for (size_t i = 0; i < n; i++)
+	{
+		size_t key;
+		is >> key >> m;
+		for (size_t j = 0; j < m; j++)
+		{
+			int t_min, t_max;
+			is >> t_min >> t_max;
+			insertCT(getSlotIndex(key), t_min, t_max);
+		}
+	}
+	if (!(is >> tag >> n) || tag != "cat")
+		return false;
+	resizeCAT((int)n);
+	for (size_t t = 0; t < n; t++)
+	{
+		is >> m;
+		for (size_t j = 0; j < m; j++)
+		{
+			size_t loc;
+			is >> loc;
+			setCAT((int)loc, (int)t, (int)t + 1);
+		}
+	}
+	if (!(is >> tag >> n) || tag != "sit")
+		return false;
+	for (size_t i = 0; i < n; i++)
+	{
+		size_t key;
+		is >> key >> m;
+		auto& slot = getSlot(getSlotIndex(key));
+		slot.sit_built = true;
+		for (size_t j = 0; j < m; j++)
+		{
+			int t_min, t_max;
+			bool conflicts;
+			is >> t_min >> t_max >> conflicts;
+			slot.sit.emplace_back(t_min, t_max, conflicts);
+		}
+	}
+	return (bool)is;
+}
@@ -1,13 +1,14 @@
 #include "SIPP.h"
 
 
-Path SIPP::updatePath(const BasicGraph& G, const SIPPNode* goal)
+template<class QueuePolicy>
+Path SIPPT<QueuePolicy>::updatePath(const BasicGraph& G, const Node* goal)
 {
     Path path(goal->state.timestep + 1);
     path_cost = goal->getFVal();
     num_of_conf = goal->conflicts;
 
-    const SIPPNode* curr = goal;
+    const Node* curr = goal;
     while (true)
     {
         if (curr->parent == nullptr) // root node
@@ -23,7 +24,7 @@ Path SIPP::updatePath(const BasicGraph& G, const SIPPNode* goal)
         }
         else
         {
-            const SIPPNode* prev = curr->parent;
+            const Node* prev = curr->parent;
             int degree = G.get_rotate_degree(prev->state.orientation, curr->state.orientation);
             int t = prev->state.timestep + 1;
             if (degree == 1) // turn right or turn left
@@ -54,15 +55,39 @@ Path SIPP::updatePath(const BasicGraph& G, const SIPPNode* goal)
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // return true if a path found (and updates vector<int> path) or false if no path exists
 // after max_timestep, switch from time-space A* search to normal A* search
-Path SIPP::run(const BasicGraph& G, const State& start,
+template<class QueuePolicy>
+Path SIPPT<QueuePolicy>::run(const BasicGraph& G, const State& start,
                const vector<pair<int, int> >& goal_location,
                ReservationTable& rt)
 {
     num_expanded = 0;
     num_generated = 0;
     runtime = 0;
+    partial_path = false;
     clock_t t = std::clock();
-	double h_val = compute_h_value(G, start.location, 0, goal_location);
+	if (query_log != nullptr)
+		record_query(start, goal_location, rt);
+	set_goal_sequence(G, goal_location);
+	set_prior_path(G, goal_location, rt);
+	last_constrained_timestep = -1;
+	switch (get_goal_value_type()) // once per search instead of once per heuristic lookup
+	{
+	case HeuristicTable::UINT16:
+		return search<uint16_t>(G, start, goal_location, rt, t);
+	case HeuristicTable::FLOAT:
+		return search<float>(G, start, goal_location, rt, t);
+	default:
+		return search<double>(G, start, goal_location, rt, t);
+	}
+}
+
+
+template<class QueuePolicy>
+template<class Value>
+Path SIPPT<QueuePolicy>::search(const BasicGraph& G, const State& start,
+	const vector<pair<int, int> >& goal_location, ReservationTable& rt, clock_t t)
+{
+	double h_val = get_h_value<Value>(G, start.location, 0, start.orientation);
 	if (h_val > INT_MAX)
 	{
 		cout << "The start and goal locations are disconnected!" << endl;
@@ -72,7 +97,7 @@ Path SIPP::run(const BasicGraph& G, const State& start,
 	
     if (std::get<0>(interval) == 0)
     {
-        auto node = new SIPPNode(start, 0, h_val, interval, nullptr, 0);
+        auto node = nodes.create(start, 0, h_val, interval, nullptr, 0);
         num_generated++;
         node->open_handle = open_list.push(node);
         node->in_openlist = true;
@@ -87,7 +112,7 @@ Path SIPP::run(const BasicGraph& G, const State& start,
         // wait at its start locations due to initial constraints caused by the previous actions
         // of other agents.
         Interval interval = make_tuple(0, INTERVAL_MAX, 0);
-        auto node = new SIPPNode(start, 0, h_val, interval, nullptr, 0);
+        auto node = nodes.create(start, 0, h_val, interval, nullptr, 0);
         num_generated++;
         node->open_handle = open_list.push(node);
         node->in_openlist = true;
@@ -99,9 +124,11 @@ Path SIPP::run(const BasicGraph& G, const State& start,
 	int earliest_holding_time = 0;
 	if (hold_endpoints)
 		earliest_holding_time = rt.getHoldingTimeFromSIT(goal_location.back().first);
+	int collapse_timestep = get_collapse_timestep(G, rt);
+	Node* best_partial = nullptr;
     while (!focal_list.empty())
     {
-        SIPPNode* curr = focal_list.top(); focal_list.pop();
+        Node* curr = focal_list.top(); focal_list.pop();
         open_list.erase(curr->open_handle);
         curr->in_openlist = false;
         num_expanded++;
@@ -114,6 +141,8 @@ Path SIPP::run(const BasicGraph& G, const State& start,
 			if (curr->goal_id == (int)goal_location.size() &&
 				earliest_holding_time > curr->state.timestep)
 				curr->goal_id--;
+			else
+				allNodes_table.insert(curr); // under its new key
         }
 		// check if the popped node is a goal
 		if (curr->goal_id == (int)goal_location.size())
@@ -122,6 +151,47 @@ Path SIPP::run(const BasicGraph& G, const State& start,
 			releaseClosedListNodes();
 			open_list.clear();
 			focal_list.clear();
+			pending_list.clear();
+			runtime = (std::clock() - t) * 1.0 / CLOCKS_PER_SEC;
+			return path;
+		}
+		if (curr->state.timestep > collapse_timestep) // no more constraints, so follow the heuristics to the goals
+		{
+			Path path = updatePath(G, curr);
+			if (complete_path(G, path, curr->goal_id, goal_location))
+			{
+				releaseClosedListNodes();
+				open_list.clear();
+				focal_list.clear();
+				pending_list.clear();
+				runtime = (std::clock() - t) * 1.0 / CLOCKS_PER_SEC;
+				return path;
+			}
+			collapse_timestep = INT_MAX;
+		}
+		if (can_reuse_prior_path(curr->state, curr->goal_id))
+		{
+			Path path = updatePath(G, curr);
+			append_prior_path(path);
+			releaseClosedListNodes();
+			open_list.clear();
+			focal_list.clear();
+			pending_list.clear();
+			runtime = (std::clock() - t) * 1.0 / CLOCKS_PER_SEC;
+			return path;
+		}
+		if (better_partial_path(curr, best_partial, rt.window))
+			best_partial = curr;
+		if (out_of_budget(t))
+		{
+			Path path = updatePath(G, best_partial);
+			partial_path = true;
+			path_cost = best_partial->g_val;
+			min_f_val = get_h_value<Value>(G, start.location, 0, start.orientation);
+			releaseClosedListNodes();
+			open_list.clear();
+			focal_list.clear();
+			pending_list.clear();
 			runtime = (std::clock() - t) * 1.0 / CLOCKS_PER_SEC;
 			return path;
 		}
@@ -140,16 +210,21 @@ Path SIPP::run(const BasicGraph& G, const State& start,
             if (degree > std::get<1>(curr->interval) - curr->state.timestep) // don't have enough time to turn
                 continue;
             int location = curr->state.location + G.move[orientation];
-            double h_val = compute_h_value(G, location, curr->goal_id, goal_location);
+            double h_val = get_h_value<Value>(G, location, curr->goal_id, curr->state.orientation < 0 ? -1 : orientation);
             if (h_val > INT_MAX)   // This vertex cannot reach the goal vertex
                 continue;
             int min_timestep = curr->state.timestep + degree + 1;
+            bool cheaper_to_wait = G.get_weight(curr->state.location, curr->state.location) <
+                G.get_weight(location, location);
             for (auto interval : rt.getSafeIntervals(curr->state.location, location, min_timestep, std::get<1>(curr->interval) + 1))
             {
                 if (curr->state.orientation < 0)
                     generate_node(interval, curr, G, location, min_timestep, -1, h_val);
                 else
                     generate_node(interval, curr, G, location, min_timestep, orientation, h_val);
+                if (cheaper_to_wait)
+                    generate_late_arrivals(interval, curr, G, rt, location, min_timestep,
+                                           curr->state.orientation < 0 ? -1 : orientation, h_val);
             }
 
         }  // end for loop that generates successors
@@ -169,11 +244,14 @@ Path SIPP::run(const BasicGraph& G, const State& start,
 				}
 				else
 				{
+					// with orientation-aware heuristics, the rotated states have their own h-values
+					auto h_val = [&](int o) { return G.heuristics.get_num_orientations() == 1 ? curr->h_val :
+						get_h_value<Value>(G, location, curr->goal_id, o); };
 					generate_node(interval, curr, G, location, min_timestep, orientation, curr->h_val);
-					generate_node(interval, curr, G, location, min_timestep, (orientation + 1) % 4, curr->h_val);
-					generate_node(interval, curr, G, location, min_timestep, (orientation + 3) % 4, curr->h_val);
+					generate_node(interval, curr, G, location, min_timestep, (orientation + 1) % 4, h_val((orientation + 1) % 4));
+					generate_node(interval, curr, G, location, min_timestep, (orientation + 3) % 4, h_val((orientation + 3) % 4));
 					if (std::get<1>(curr->interval) - curr->state.timestep > 1)
-						generate_node(interval, curr, G, location, min_timestep, (orientation + 2) % 4, curr->h_val);
+						generate_node(interval, curr, G, location, min_timestep, (orientation + 2) % 4, h_val((orientation + 2) % 4));
 				}
             }
         }
@@ -188,8 +266,8 @@ Path SIPP::run(const BasicGraph& G, const State& start,
                 // of other agents.
                 Interval interval = rt.getFirstSafeInterval(start.location);
                 Interval interval2 = make_tuple(std::get<1>(interval), INTERVAL_MAX, 0);
-                double h_val = compute_h_value(G, start.location, 0, goal_location);
-                auto node2 = new SIPPNode(start, 0, h_val, interval2, nullptr, 0);
+                double h_val = get_h_value<Value>(G, start.location, 0, start.orientation);
+                auto node2 = nodes.create(start, 0, h_val, interval2, nullptr, 0);
                 num_generated++;
                 node2->open_handle = open_list.push(node2);
                 node2->in_openlist = true;
@@ -205,15 +283,15 @@ Path SIPP::run(const BasicGraph& G, const State& start,
         }
         else
         {
-            SIPPNode* open_head = open_list.top();
+            Node* open_head = open_list.top();
             if (open_head->getFVal() > min_f_val)
             {
                 double new_min_f_val = open_head->getFVal();
                 double new_focal_bound = new_min_f_val * suboptimal_bound;
-                for (SIPPNode* n : open_list)
+                while (!pending_list.empty() && pending_list.top()->getFVal() <= new_focal_bound)
                 {
-                    if (n->getFVal() > focal_bound && n->getFVal() <= new_focal_bound)
-                        n->focal_handle = focal_list.push(n);
+                    Node* n = pending_list.top(); pending_list.pop();
+                    n->focal_handle = focal_list.push(n);
                 }
                 min_f_val = new_min_f_val;
                 focal_bound = new_focal_bound;
@@ -226,123 +304,13 @@ Path SIPP::run(const BasicGraph& G, const State& start,
     releaseClosedListNodes();
     open_list.clear();
     focal_list.clear();
+    pending_list.clear();
     return Path();
 }
 
 
-/*void SIPP::generate_node(SIPPNode* curr, const SortationGrid& G,
-                         int location, int timestep, int orientation, double h_val)
-{
-    int wait_time = timestep - curr->state.timestep - 1; // inlcude rotate time
-    double travel_time = 1;
-    if (!travel_times.empty())
-    {
-        int dir = G.get_direction(curr->state.location, location);
-        travel_time += travel_times[curr->state.location][dir];
-    }
-    double g_val = curr->g_val + travel_time * (wait_time * G.get_weight(curr->state.location, curr->state.location)
-                   + G.get_weight(curr->state.location, location));
-
-    int conflicts = curr->conflicts;
-
-    // generate (maybe temporary) node
-    auto next = new SIPPNode(State(location, timestep, orientation),
-                             g_val, h_val, Interval(window + 1, INTERVAL_MAX, 0), curr, conflicts);
-
-    // try to retrieve it from the hash table
-    auto it = allNodes_table.find(next);
-    if (it != allNodes_table.end() && (*it)->state.timestep != next->state.timestep)
-    { // arrive at the same interval at different timestep
-        int waiting_time = (*it)->state.timestep - next->state.timestep;
-        double waiting_cost = abs(G.get_weight(next->state.location, next->state.location) * waiting_time);
-        double next_f_val = next->getFVal() + waiting_cost;
-        if (waiting_time > 0 && next_f_val <= (*it)->getFVal())
-        { // next arrives earlier with a smaller cost
-            // so delete it
-            // let the following update it with next
-        }
-        else if (waiting_time < 0 && next_f_val >= (*it)->getFVal())
-        { // it arrives earlier with a smaller cost
-            delete next; // so delete next
-            return;
-        }
-        else // the later node arrives with a smaller cost, so they cannot be regarded as the same state
-            it = allNodes_table.end();
-    }
-    if (it == allNodes_table.end())
-    {
-        next->open_handle = open_list.push(next);
-        next->in_openlist = true;
-        num_generated++;
-        if (next->getFVal() <= focal_bound)
-            next->focal_handle = focal_list.push(next);
-        allNodes_table.insert(next);
-        return;
-    }
-
-    // update existing node if needed (only in the open_list)
-    SIPPNode* existing_next = *it;
-    double existing_f_val = existing_next->getFVal();
-
-    if (existing_next->in_openlist)
-    {  // if its in the open list
-        if (existing_f_val > g_val + h_val ||
-            (existing_f_val == g_val + h_val && existing_next->conflicts > conflicts))
-        {
-            // if f-val decreased through this new path (or it remains the same and there's less internal conflicts)
-            bool add_to_focal = false;  // check if it was above the focal bound before and now below (thus need to be inserted)
-            bool update_in_focal = false;  // check if it was inside the focal and needs to be updated (because f-val changed)
-            bool update_open = false;
-            if ((g_val + h_val) <= focal_bound)
-            {  // if the new f-val qualify to be in FOCAL
-                if (existing_f_val > focal_bound)
-                    add_to_focal = true;  // and the previous f-val did not qualify to be in FOCAL then add
-                else
-                    update_in_focal = true;  // and the previous f-val did qualify to be in FOCAL then update
-            }
-            if (existing_f_val > g_val + h_val)
-                update_open = true;
-            // update existing node
-            existing_next->state = next->state;
-            existing_next->g_val = g_val;
-            existing_next->h_val = h_val;
-            existing_next->parent = curr;
-            existing_next->depth = next->depth;
-            existing_next->conflicts = conflicts;
-            // existing_next->move = next->move;
-
-            if (update_open)
-                open_list.increase(existing_next->open_handle);  // increase because f-val improved
-            if (add_to_focal)
-                existing_next->focal_handle = focal_list.push(existing_next);
-            if (update_in_focal)
-                focal_list.update(existing_next->focal_handle);  // should we do update? yes, because number of conflicts may go up or down
-        }
-    }
-    else
-    {  // if its in the closed list (reopen)
-        if (existing_f_val > g_val + h_val ||
-            (existing_f_val == g_val + h_val && existing_next->conflicts > conflicts))
-        {
-            // if f-val decreased through this new path (or it remains the same and there's less internal conflicts)
-            existing_next->state = next->state;
-            existing_next->g_val = g_val;
-            existing_next->h_val = h_val;
-            existing_next->parent = curr;
-            existing_next->depth = next->depth;
-            existing_next->conflicts = conflicts;
-            existing_next->open_handle = open_list.push(existing_next);
-            existing_next->in_openlist = true;
-            if (existing_f_val <= focal_bound)
-                existing_next->focal_handle = focal_list.push(existing_next);
-        }
-    }  // end update a node in closed list
-
-    delete(next);  // not needed anymore -- we already generated it before
-}*/
-
-
-void SIPP::generate_node(const Interval& interval, SIPPNode* curr, const BasicGraph& G,
+template<class QueuePolicy>
+void SIPPT<QueuePolicy>::generate_node(const Interval& interval, Node* curr, const BasicGraph& G,
         int location, int min_timestep, int orientation, double h_val)
 {
     int timestep  = max(std::get<0>(interval), min_timestep);
@@ -352,47 +320,43 @@ void SIPP::generate_node(const Interval& interval, SIPPNode* curr, const BasicGr
 
     int conflicts = std::get<2>(interval) + curr->conflicts;
 
-    // generate (maybe temporary) node
-    auto next = new SIPPNode(State(location, timestep, orientation),
-                             g_val, h_val, interval, curr, conflicts);
+    // generate a temporary node for the lookup
+    Node temp(State(location, timestep, orientation), g_val, h_val, interval, curr, conflicts);
+    auto next = &temp;
 
     // try to retrieve it from the hash table
-    auto it = allNodes_table.find(next);
-    /*if (it != allNodes_table.end() && (*it)->state.timestep != next->state.timestep)
-    { // arrive at the same interval at different timestep
-        int waiting_time = (*it)->state.timestep - next->state.timestep;
-        double waiting_cost = abs(G.get_weight(next->state.location, next->state.location) * waiting_time);
-        if (waiting_time > 0 && next->getFVal() + waiting_cost <= (*it)->getFVal())
-        { // next arrives later with a smaller cost
-            // let the following update it with next
-        }
-        else if (waiting_time < 0 && next->getFVal() >= (*it)->getFVal() + waiting_cost)
-        { // next arrives earlier with a larger cost
-            delete next; // so delete next
-            return;
-        }
-        else // next arrives with a smaller cost, so they cannot be regarded as the same state
-            it = allNodes_table.end(); // TODO: fix this bug! When later inserting this node to allNodes_table, it will not override the previous node.
-    }*/
-    if (it == allNodes_table.end())
+    double wait_cost = G.get_weight(location, location);
+    Node* existing_next = find_comparable_node(*next, wait_cost);
+    if (existing_next == nullptr)
     {
+        next = nodes.create(temp);
         next->open_handle = open_list.push(next);
         next->in_openlist = true;
         num_generated++;
         if (next->getFVal() <= focal_bound)
             next->focal_handle = focal_list.push(next);
-        allNodes_table.insert(next);
+        else
+            next->pending_handle = pending_list.push(next);
+        Node* head = allNodes_table.find(next->get_key());
+        if (head == nullptr)
+            allNodes_table.insert(next);
+        else
+        {
+            next->next_arrival = head->next_arrival;
+            head->next_arrival = next;
+        }
         return;
     }
 
-    // update existing node if needed (only in the open_list)
-    SIPPNode* existing_next = *it;
+    // update existing node if needed: if next arrives earlier at no higher cost, or
+    // if its f-val decreased (or it remains the same and there's less internal conflicts)
     double existing_f_val = existing_next->getFVal();
+    bool improved = !covers(*existing_next, *next, wait_cost) || existing_f_val > g_val + h_val ||
+        (existing_f_val == g_val + h_val && existing_next->conflicts > conflicts);
 
     if (existing_next->in_openlist)
     {  // if its in the open list
-        if (existing_f_val > g_val + h_val ||
-            (existing_f_val == g_val + h_val && existing_next->conflicts > conflicts))
+        if (improved)
         {
             // if f-val decreased through this new path (or it remains the same and there's less internal conflicts)
             bool add_to_focal = false;  // check if it was above the focal bound before and now below (thus need to be inserted)
@@ -419,17 +383,20 @@ void SIPP::generate_node(const Interval& interval, SIPPNode* curr, const BasicGr
             if (update_open)
                 open_list.increase(existing_next->open_handle);  // increase because f-val improved
             if (add_to_focal)
+            {
+                pending_list.erase(existing_next->pending_handle);
                 existing_next->focal_handle = focal_list.push(existing_next);
+            }
+            else if (update_open && existing_f_val > focal_bound)
+                pending_list.increase(existing_next->pending_handle);  // still above the bound, but f-val improved
             if (update_in_focal)
                 focal_list.update(existing_next->focal_handle);  // should we do update? yes, because number of conflicts may go up or down
         }
     }
     else
     {  // if its in the closed list (reopen)
-        if (existing_f_val > g_val + h_val ||
-            (existing_f_val == g_val + h_val && existing_next->conflicts > conflicts))
+        if (improved)
         {
-            // if f-val decreased through this new path (or it remains the same and there's less internal conflicts)
             existing_next->state = next->state;
             existing_next->g_val = g_val;
             existing_next->h_val = h_val;
@@ -438,21 +405,49 @@ void SIPP::generate_node(const Interval& interval, SIPPNode* curr, const BasicGr
             existing_next->conflicts = conflicts;
             existing_next->open_handle = open_list.push(existing_next);
             existing_next->in_openlist = true;
-            if (existing_f_val <= focal_bound)
+            if (existing_next->getFVal() <= focal_bound)
                 existing_next->focal_handle = focal_list.push(existing_next);
+            else
+                existing_next->pending_handle = pending_list.push(existing_next);
         }
     }  // end update a node in closed list
+}
 
-    delete(next);  // not needed anymore -- we already generated it before
+template<class QueuePolicy>
+void SIPPT<QueuePolicy>::generate_late_arrivals(const Interval& interval, Node* curr, const BasicGraph& G,
+        ReservationTable& rt, int location, int min_timestep, int orientation, double h_val)
+{
+    if (last_constrained_timestep < 0)
+        last_constrained_timestep = rt.getLastConstrainedTimestep();
+    // leave curr within its interval, and there is no point in waiting after the last constraint
+    int latest = min(min(std::get<1>(interval), std::get<1>(curr->interval) + 1) - 1, last_constrained_timestep + 1);
+    for (int arrival = max(std::get<0>(interval), min_timestep) + 1; arrival <= latest; arrival++)
+        generate_node(interval, curr, G, location, arrival, orientation, h_val);
 }
 
-inline void SIPP::releaseClosedListNodes()
+
+template<class QueuePolicy>
+typename SIPPT<QueuePolicy>::Node* SIPPT<QueuePolicy>::find_comparable_node(const Node& next, double wait_cost) const
 {
-    for (auto it = allNodes_table.begin(); it != allNodes_table.end(); it++)
-        delete (*it);
-    allNodes_table.clear();
+    uint64_t key = next.get_key();
+    for (Node* node = allNodes_table.find(key); node != nullptr; node = node->next_arrival)
+    {
+        if (node->get_key() == key && (covers(*node, next, wait_cost) || covers(next, *node, wait_cost)))
+            return node;
+    }
+    return nullptr;
 }
 
 
+template<class QueuePolicy>
+inline void SIPPT<QueuePolicy>::releaseClosedListNodes()
+{
+    allNodes_table.clear();
+    nodes.reset();
+}
 
 
+template class SIPPT<FibonacciHeapPolicy>;
+template class SIPPT<DaryHeapPolicy>;
+template class SIPPT<PairingHeapPolicy>;
+template class SIPPT<BucketQueuePolicy>;
@@ -1,15 +1,226 @@
 #include "SingleAgentSolver.h"
+#include "StateTimeAStar.h"
+#include "SIPP.h"
 
 
 double SingleAgentSolver::compute_h_value(const BasicGraph& G, int curr, int goal_id,
-                             const vector<pair<int, int> >& goal_location) const
+                             const vector<pair<int, int> >& goal_location, int orientation) const
 {
-    double h = G.heuristics.at(goal_location[goal_id].first)[curr];
+    double h = G.heuristics.get(goal_location[goal_id].first, curr, orientation);
     goal_id++;
     while (goal_id < (int) goal_location.size())
     {
-        h += G.heuristics.at(goal_location[goal_id].first)[goal_location[goal_id - 1].first];
+        h += G.heuristics.get(goal_location[goal_id].first, goal_location[goal_id - 1].first);
         goal_id++;
     }
     return h;
 }
+
+
+void SingleAgentSolver::set_goal_sequence(const BasicGraph& G, const vector<pair<int, int> >& goal_location)
+{
+	int n = (int)goal_location.size();
+	goal_sequence.resize(n);
+	for (int i = 0; i < n; i++)
+		goal_sequence[i] = goal_location[i].first;
+	vector<int> rows;
+	G.heuristics.get_rows(goal_sequence, rows);
+	goal_suffix_costs.resize(n);
+	for (int i = n - 1; i >= 0; i--)
+	{
+		if (i == n - 1)
+			goal_suffix_costs[i] = 0;
+		else
+			goal_suffix_costs[i] = G.heuristics.get_by_row(rows[i + 1], goal_location[i].first) +
+				goal_suffix_costs[i + 1];
+	}
+
+	goal_value_type = G.heuristics.get_value_type();
+	goal_num_orientations = G.heuristics.get_num_orientations();
+	goal_rows.resize(n);
+	for (int i = 0; i < n; i++)
+	{
+		switch (goal_value_type)
+		{
+		case HeuristicTable::UINT16:
+			goal_rows[i] = G.heuristics.get_row_values<uint16_t>(rows[i]);
+			break;
+		case HeuristicTable::FLOAT:
+			goal_rows[i] = G.heuristics.get_row_values<float>(rows[i]);
+			break;
+		case HeuristicTable::DOUBLE:
+			goal_rows[i] = G.heuristics.get_row_values<double>(rows[i]);
+			break;
+		}
+	}
+}
+
+
+int SingleAgentSolver::get_collapse_timestep(const BasicGraph& G, const ReservationTable& RT) const
+{
+	if (!collapse_horizon || RT.window >= INT_MAX / 2)
+		return INT_MAX;
+	// the descent follows the heuristics, so they have to be exact distances
+	if (G.consider_rotation && G.heuristics.get_num_orientations() == 1)
+		return INT_MAX;
+	return max(RT.window, RT.getLastConstrainedTimestep());
+}
+
+
+bool SingleAgentSolver::complete_path(const BasicGraph& G, Path& path, int goal_id,
+	const vector<pair<int, int> >& goal_location) const
+{
+	State curr = path.back();
+	int steps = 0; // since the last goal, to stop at zero-weight cycles
+	while (true)
+	{
+		while (goal_id < (int)goal_location.size() && curr.location == goal_location[goal_id].first &&
+			curr.timestep >= goal_location[goal_id].second)
+		{
+			goal_id++;
+			steps = 0;
+		}
+		if (goal_id == (int)goal_location.size())
+			return true;
+		if (++steps > G.size() * 4)
+			return false;
+
+		State next(curr.location, curr.timestep + 1, curr.orientation);
+		if (curr.location != goal_location[goal_id].first) // otherwise, wait for the release time of the goal
+		{
+			double h_val = get_h_value(G, curr.location, goal_id, curr.orientation);
+			double best_f_val = DBL_MAX;
+			double best_h_val = DBL_MAX;
+			for (const auto& neighbor : G.get_successors(curr))
+			{
+				double next_h_val = get_h_value(G, neighbor.location, goal_id, neighbor.orientation);
+				double next_f_val = neighbor.weight + next_h_val;
+				if (next_f_val < best_f_val || (next_f_val == best_f_val && next_h_val < best_h_val))
+				{
+					next = State(neighbor.location, curr.timestep + 1, neighbor.orientation);
+					best_f_val = next_f_val;
+					best_h_val = next_h_val;
+				}
+			}
+			if (best_f_val > h_val + 1e-6 * max(1.0, h_val)) // the heuristics are not exact here
+				return false;
+		}
+		path.push_back(next);
+		curr = next;
+	}
+}
+
+
+Path SingleAgentSolver::replan(const BasicGraph& G, const State& start,
+	const vector<pair<int, int> >& goal_location, ReservationTable& RT, const Path& prior_path)
+{
+	this->prior_path = &prior_path;
+	Path path = run(G, start, goal_location, RT);
+	this->prior_path = nullptr;
+	return path;
+}
+
+
+void SingleAgentSolver::set_prior_path(const BasicGraph& G, const vector<pair<int, int> >& goal_location,
+	const ReservationTable& RT)
+{
+	prior_goal_ids.clear();
+	prior_reusable.clear();
+	if (prior_path == nullptr || prior_path->empty())
+		return;
+	const Path& prior = *prior_path;
+	int n = (int)prior.size();
+
+	// follow the goal ids as the search does
+	int earliest_holding_time = hold_endpoints ? RT.getHoldingTimeFromCT(goal_location.back().first) : 0;
+	prior_goal_ids.resize(n);
+	int goal_id = 0;
+	for (int t = 0; t < n; t++)
+	{
+		if (goal_id < (int)goal_location.size() && prior[t].location == goal_location[goal_id].first &&
+			t >= goal_location[goal_id].second &&
+			!(goal_id == (int)goal_location.size() - 1 && earliest_holding_time > t))
+			goal_id++;
+		prior_goal_ids[t] = goal_id;
+	}
+	if (goal_id < (int)goal_location.size()) // the goals have changed
+		return;
+
+	prior_reusable.resize(n, false);
+	double suffix_cost = 0;
+	for (int t = n - 1; t >= 0; t--)
+	{
+		if (t < n - 1)
+		{
+			if (RT.isConstrained(prior[t].location, prior[t + 1].location, t + 1) ||
+				RT.isConflicting(prior[t].location, prior[t + 1].location, t + 1))
+				break;
+			suffix_cost += G.get_weight(prior[t].location, prior[t + 1].location);
+		}
+		if (prior_goal_ids[t] < (int)goal_location.size())
+		{
+			double h_val = get_h_value(G, prior[t].location, prior_goal_ids[t], prior[t].orientation);
+			prior_reusable[t] = suffix_cost <= h_val + 1e-6 * max(1.0, h_val);
+		}
+	}
+}
+
+
+void SingleAgentSolver::append_prior_path(Path& path) const
+{
+	for (int t = path.back().timestep + 1; t < (int)prior_path->size(); t++)
+		path.push_back((*prior_path)[t]);
+}
+
+
+void SingleAgentSolver::record_query(const State& start, const vector<pair<int, int> >& goal_location,
+	const ReservationTable& RT) const
+{
+	*query_log << "query " << start.location << " " << start.timestep << " " << start.orientation << " "
+		<< prioritize_start << " " << hold_endpoints << " " << suboptimal_bound << " " << goal_location.size();
+	for (const auto& goal : goal_location)
+		*query_log << " " << goal.first << " " << goal.second;
+	*query_log << endl;
+	RT.save(*query_log);
+}
+
+
+bool SingleAgentSolver::load_query(std::istream& is, State& start, vector<pair<int, int> >& goal_location,
+	ReservationTable& RT)
+{
+	string tag;
+	size_t num_goals;
+	if (!(is >> tag) || tag != "query")
+		return false;
+	is >> start.location >> start.timestep >> start.orientation >> prioritize_start >> hold_endpoints
+		>> suboptimal_bound >> num_goals;
+	goal_location.resize(num_goals);
+	for (auto& goal : goal_location)
+		is >> goal.first >> goal.second;
+	return is && RT.load(is);
+}
+
+
+template<template<class> class Solver>
+static SingleAgentSolver* create_single_agent_solver(const string& queue)
+{
+	if (queue == FibonacciHeapPolicy::name)
+		return new Solver<FibonacciHeapPolicy>();
+	else if (queue == DaryHeapPolicy::name)
+		return new Solver<DaryHeapPolicy>();
+	else if (queue == PairingHeapPolicy::name)
+		return new Solver<PairingHeapPolicy>();
+	else if (queue == BucketQueuePolicy::name)
+		return new Solver<BucketQueuePolicy>();
+	return nullptr;
+}
+
+
+SingleAgentSolver* create_single_agent_solver(const string& name, const string& queue)
+{
+	if (name == "ASTAR")
+		return create_single_agent_solver<StateTimeAStarT>(queue);
+	else if (name == "SIPP")
+		return create_single_agent_solver<SIPPT>(queue);
+	return nullptr;
+}
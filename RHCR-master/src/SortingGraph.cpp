@@ -28,16 +28,12 @@ bool SortingGrid::load_map(std::string fname)
 	this->rows = atoi((*beg).c_str()); // read number of cols
 	beg++;
 	this->cols = atoi((*beg).c_str()); // read number of rows
-	move[0] = 1;
-	move[1] = -cols;
-	move[2] = -1;
-	move[3] = cols;
+	init_weights();
 
 	getline(myfile, line); // skip the headers
 
 	//read tyeps, station ids and edge weights
 	this->types.resize(rows * cols);
-	this->weights.resize(rows * cols);
 	for (int i = 0; i < rows * cols; i++)
 	{
 		getline(myfile, line);
@@ -60,13 +56,12 @@ bool SortingGrid::load_map(std::string fname)
 		beg++;
 		beg++; // skip x
 		beg++; // skip y
-		weights[i].resize(5);
 		for (int j = 0; j < 5; j++) // read edge weights
 		{
 			if (std::string(beg->c_str()) == "inf")
-				weights[i][j] = WEIGHT_MAX;
+				set_weight(i, j, WEIGHT_MAX);
 			else
-				weights[i][j] = std::stod(beg->c_str());
+				set_weight(i, j, std::stod(beg->c_str()));
 			beg++;
 		}
 	}
@@ -83,45 +78,30 @@ bool SortingGrid::load_map(std::string fname)
 void SortingGrid::preprocessing(bool consider_rotation)
 {
 	std::cout << "*** PreProcessing map ***" << std::endl;
-	clock_t t = std::clock();
+	auto start = std::chrono::steady_clock::now();
 	this->consider_rotation = consider_rotation;
-	std::string fname;
-	if (consider_rotation)
-		fname = map_name + "_rotation_heuristics_table.txt";
-	else
-		fname = map_name + "_heuristics_table.txt";
-	std::ifstream myfile(fname.c_str());
-	bool succ = false;
-	if (myfile.is_open())
+	build_neighbor_table();
+	build_cell_types();
+	vector<int> roots;
+	for (auto induct : inducts)
 	{
-		succ = load_heuristics_table(myfile);
-		myfile.close();
-		// ensure that the heuristic table is correct
-		for (auto h : heuristics)
-		{
-			if (types[h.first] != "Induct" && types[h.first] != "Eject")
-			{
-				cout << "The heuristic table does not match the map!" << endl;
-				exit(-1);
-			}
-		}
+		roots.push_back(induct.second);
 	}
-	if (!succ)
+	for (auto eject_station : ejects)
 	{
-		for (auto induct : inducts)
-		{
-			heuristics[induct.second] = compute_heuristics(induct.second);
-		}
-		for (auto eject_station : ejects)
+		roots.insert(roots.end(), eject_station.second.begin(), eject_station.second.end());
+	}
+	build_heuristics_table(roots);
+	// ensure that the heuristic table is correct
+	for (int root : heuristics.get_roots())
+	{
+		if (!is_type(root, INDUCT) && !is_type(root, EJECT))
 		{
-			for (int eject : eject_station.second)
-			{
-				heuristics[eject] = compute_heuristics(eject);
-			}
+			cout << "The heuristic table does not match the map!" << endl;
+			exit(-1);
 		}
-		save_heuristics_table(fname);
 	}
 
-	double runtime = (std::clock() - t) / CLOCKS_PER_SEC;
+	double runtime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 	std::cout << "Done! (" << runtime << " s)" << std::endl;
 }
@@ -24,7 +24,7 @@ void SortingSystem::initialize_start_locations()
 	for (int k = 0; k < num_of_drives;)
 	{
 		int loc = rand() % N;
-		if (G.types[loc] != "Obstacle" && !used[loc])
+		if (!G.is_type(loc, OBSTACLE) && !used[loc])
 		{
 			int orientation = -1;
 			if (consider_rotation)
@@ -88,11 +88,11 @@ void SortingSystem::update_goal_locations()
 		{
 			// assign a new task
 			int next;
-			if (G.types[goal.first] == "Induct")
+			if (G.is_type(goal.first, INDUCT))
 			{
 				next = assign_eject_station();
 			}
-			else if (G.types[goal.first] == "Eject")
+			else if (G.is_type(goal.first, EJECT))
 			{
 				next = assign_induct_station(curr.first);
 				drives_in_induct_stations[next]++; // the drive will go to the next induct station
@@ -118,7 +118,7 @@ int SortingSystem::assign_induct_station(int curr) const
 	double min_cost = DBL_MAX;
 	for (auto induct : drives_in_induct_stations)
 	{
-		double cost = G.heuristics.at(induct.first)[curr] + c * induct.second;
+		double cost = G.heuristics.get(induct.first, curr) + c * induct.second;
 		if (cost < min_cost)
 		{
 			min_cost = cost;
@@ -165,7 +165,7 @@ void SortingSystem::simulate(int simulation_time)
 			std::tie(id, loc, t) = task;
 			finished_tasks[id].emplace_back(loc, t);
 			num_of_tasks++;
-			if (G.types[loc] == "Induct")
+			if (G.is_type(loc, INDUCT))
 			{
 				drives_in_induct_stations[loc]--; // the drive will leave the current induct station
 			}
@@ -218,11 +218,11 @@ void SortingSystem::initialize()
 	{
 		// goals
 		int goal = goal_locations[k].back().first;
-		if (G.types[goal] == "Induct")
+		if (G.is_type(goal, INDUCT))
 		{
 			drives_in_induct_stations[goal]++;
 		}
-		else if (G.types[goal] != "Eject")
+		else if (!G.is_type(goal, EJECT))
 		{
 			std::cout << "ERROR in the type of goal locations" << std::endl;
 			std::cout << "The fiducial type of the goal of agent " << k << " is " << G.types[goal] << std::endl;
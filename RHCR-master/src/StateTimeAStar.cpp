@@ -1,7 +1,8 @@
 #include "StateTimeAStar.h"
 
 
-Path StateTimeAStar::updatePath(const StateTimeAStarNode* goal)
+template<class QueuePolicy>
+Path StateTimeAStarT<QueuePolicy>::updatePath(const Node* goal)
 {
     // std::cout << "Update path .. " << std::endl;
     Path path(goal->state.timestep + 1);
@@ -9,7 +10,7 @@ Path StateTimeAStar::updatePath(const StateTimeAStarNode* goal)
     // std::cout << goal->timestep << "," << path.size() <<
     //    "," << goal->conflicts << std::endl;
     num_of_conf = goal->conflicts;
-    const StateTimeAStarNode* curr = goal;
+    const Node* curr = goal;
     for(int t = goal->state.timestep; t >= 0; t--)
     {
         if (curr->state.timestep > t)
@@ -23,11 +24,12 @@ Path StateTimeAStar::updatePath(const StateTimeAStarNode* goal)
 }
 
 
-list<pair<int, int> > StateTimeAStar::updateTrajectory(const StateTimeAStarNode* goal)
+template<class QueuePolicy>
+list<pair<int, int> > StateTimeAStarT<QueuePolicy>::updateTrajectory(const Node* goal)
 {
     list<pair<int, int> > trajectory;
     path_cost = goal->getFVal();
-    const StateTimeAStarNode* curr = goal;
+    const Node* curr = goal;
     while (curr != nullptr)
     {
         trajectory.emplace_front(curr->state.location, curr->state.orientation);
@@ -41,15 +43,38 @@ list<pair<int, int> > StateTimeAStar::updateTrajectory(const StateTimeAStarNode*
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // return true if a path found (and updates vector<int> path) or false if no path exists
 // after max_timestep, switch from time-space A* search to normal A* search
-Path StateTimeAStar::run(const BasicGraph& G, const State& start, 
+template<class QueuePolicy>
+Path StateTimeAStarT<QueuePolicy>::run(const BasicGraph& G, const State& start, 
 	const vector<pair<int, int> >& goal_location, ReservationTable& rt)
 {
     num_expanded = 0;
     num_generated = 0;
 	runtime = 0;
+	partial_path = false;
 	clock_t t = std::clock();
+	if (query_log != nullptr)
+		record_query(start, goal_location, rt);
 
-	double h_val = compute_h_value(G, start.location, 0, goal_location);
+	set_goal_sequence(G, goal_location);
+	set_prior_path(G, goal_location, rt);
+	switch (get_goal_value_type()) // once per search instead of once per heuristic lookup
+	{
+	case HeuristicTable::UINT16:
+		return search<uint16_t>(G, start, goal_location, rt, t);
+	case HeuristicTable::FLOAT:
+		return search<float>(G, start, goal_location, rt, t);
+	default:
+		return search<double>(G, start, goal_location, rt, t);
+	}
+}
+
+
+template<class QueuePolicy>
+template<class Value>
+Path StateTimeAStarT<QueuePolicy>::search(const BasicGraph& G, const State& start,
+	const vector<pair<int, int> >& goal_location, ReservationTable& rt, clock_t t)
+{
+	double h_val = get_h_value<Value>(G, start.location, 0, start.orientation);
 	if (h_val > INT_MAX)
 	{
 		cout << "The start and goal locations are disconnected!" << endl;
@@ -59,8 +84,9 @@ Path StateTimeAStar::run(const BasicGraph& G, const State& start,
         return Path();
 
 	// generate root and add it to the OPEN list
-	StateTimeAStarNode* root;
-    root = new StateTimeAStarNode(start, 0, h_val, nullptr, 0);
+	Node* root;
+    root = nodes.create(start, 0, h_val, nullptr, 0);
+    root->tie_breaker = get_tie_breaker();
     num_generated++;
     root->open_handle = open_list.push(root);
     root->focal_handle = focal_list.push(root);
@@ -72,10 +98,12 @@ Path StateTimeAStar::run(const BasicGraph& G, const State& start,
 	int earliest_holding_time = 0;
 	if (hold_endpoints)
 		earliest_holding_time = rt.getHoldingTimeFromCT(goal_location.back().first);
+	int collapse_timestep = get_collapse_timestep(G, rt);
+	Node* best_partial = nullptr;
 
     while (!focal_list.empty())
     {
-        StateTimeAStarNode* curr = focal_list.top(); focal_list.pop();
+        Node* curr = focal_list.top(); focal_list.pop();
         open_list.erase(curr->open_handle);
         curr->in_openlist = false;
         num_expanded++;
@@ -85,7 +113,10 @@ Path StateTimeAStar::run(const BasicGraph& G, const State& start,
 			curr->state.timestep >= goal_location[curr->goal_id].second &&
 			!(curr->goal_id == (int)goal_location.size() - 1 &&
 				earliest_holding_time > curr->state.timestep))
+		{
 			curr->goal_id++;
+			allNodes_table.insert(curr); // under its new key
+		}
 		// check if the popped node is a goal
 		if (curr->goal_id == (int)goal_location.size())
 		{
@@ -93,41 +124,86 @@ Path StateTimeAStar::run(const BasicGraph& G, const State& start,
 			releaseClosedListNodes();
 			open_list.clear();
 			focal_list.clear();
+			pending_list.clear();
+			runtime = (double)(std::clock() - t) / CLOCKS_PER_SEC;
+			return path;
+		}
+		if (curr->state.timestep > collapse_timestep) // no more constraints, so follow the heuristics to the goals
+		{
+			Path path = updatePath(curr);
+			if (complete_path(G, path, curr->goal_id, goal_location))
+			{
+				releaseClosedListNodes();
+				open_list.clear();
+				focal_list.clear();
+				pending_list.clear();
+				runtime = (double)(std::clock() - t) / CLOCKS_PER_SEC;
+				return path;
+			}
+			collapse_timestep = INT_MAX;
+		}
+		if (can_reuse_prior_path(curr->state, curr->goal_id))
+		{
+			Path path = updatePath(curr);
+			append_prior_path(path);
+			releaseClosedListNodes();
+			open_list.clear();
+			focal_list.clear();
+			pending_list.clear();
+			runtime = (double)(std::clock() - t) / CLOCKS_PER_SEC;
+			return path;
+		}
+		if (better_partial_path(curr, best_partial, rt.window))
+			best_partial = curr;
+		if (out_of_budget(t))
+		{
+			Path path = updatePath(best_partial);
+			partial_path = true;
+			path_cost = best_partial->g_val;
+			min_f_val = get_h_value<Value>(G, start.location, 0, start.orientation);
+			releaseClosedListNodes();
+			open_list.clear();
+			focal_list.clear();
+			pending_list.clear();
 			runtime = (double)(std::clock() - t) / CLOCKS_PER_SEC;
 			return path;
 		}
 
-        for (const auto& next_state: G.get_neighbors(curr->state))
+        for (const auto& neighbor: G.get_successors(curr->state))
         {
+            State next_state(neighbor.location, curr->state.timestep + 1, neighbor.orientation);
             if (!rt.isConstrained(curr->state.location, next_state.location, next_state.timestep))
             {
                 // compute cost to next_id via curr node
-                double next_g_val = curr->g_val + G.get_weight(curr->state.location, next_state.location);
-                double next_h_val = compute_h_value(G, next_state.location, curr->goal_id, goal_location);
+                double next_g_val = curr->g_val + neighbor.weight;
+                double next_h_val = get_h_value<Value>(G, next_state.location, curr->goal_id, next_state.orientation);
                 if (next_h_val >= INT_MAX) // This vertex cannot reach the goal vertex
                     continue;
                 int next_conflicts = curr->conflicts;
 				if (rt.isConflicting(curr->state.location, next_state.location, next_state.timestep))
 					next_conflicts++;
 
-                // generate (maybe temporary) node
-                auto next = new StateTimeAStarNode(next_state, next_g_val, next_h_val, curr, next_conflicts);
+                // generate a temporary node for the lookup
+                Node temp(next_state, next_g_val, next_h_val, curr, next_conflicts);
+                auto next = &temp;
 
                 // try to retrieve it from the hash table
-                auto it = allNodes_table.find(next);
-                if (it == allNodes_table.end())
+                Node* existing_next = allNodes_table.find(next->get_key());
+                if (existing_next == nullptr)
                 {
+                    next = nodes.create(temp);
+                    next->tie_breaker = get_tie_breaker();
                     next->open_handle = open_list.push(next);
                     next->in_openlist = true;
                     num_generated++;
                     if (next->getFVal() <= lower_bound)
                         next->focal_handle = focal_list.push(next);
+                    else
+                        next->pending_handle = pending_list.push(next);
                     allNodes_table.insert(next);
                 }
                 else
                 {  // update existing node's if needed (only in the open_list)
-                    StateTimeAStarNode* existing_next = *it;
-
                     if (existing_next->in_openlist)
                     {  // if its in the open list
                         if (existing_next->getFVal() > next_g_val + next_h_val ||
@@ -137,6 +213,7 @@ Path StateTimeAStar::run(const BasicGraph& G, const State& start,
                             bool add_to_focal = false;  // check if it was above the focal bound before and now below (thus need to be inserted)
                             bool update_in_focal = false;  // check if it was inside the focal and needs to be updated (because f-val changed)
                             bool update_open = false;
+                            bool in_pending = existing_next->getFVal() > lower_bound;
                             if ((next_g_val + next_h_val) <= lower_bound)
                             {  // if the new f-val qualify to be in FOCAL
                                 if (existing_next->getFVal() > lower_bound)
@@ -157,7 +234,12 @@ Path StateTimeAStar::run(const BasicGraph& G, const State& start,
                             if (update_open)
                                 open_list.increase(existing_next->open_handle);  // increase because f-val improved
                             if (add_to_focal)
+                            {
+                                pending_list.erase(existing_next->pending_handle);
                                 existing_next->focal_handle = focal_list.push(existing_next);
+                            }
+                            else if (update_open && in_pending)
+                                pending_list.increase(existing_next->pending_handle);  // still above the bound, but f-val improved
                             if (update_in_focal)
                                 focal_list.update(existing_next->focal_handle);  // should we do update? yes, because number of conflicts may go up or down
                         }
@@ -177,9 +259,10 @@ Path StateTimeAStar::run(const BasicGraph& G, const State& start,
                             existing_next->in_openlist = true;
                             if (existing_next->getFVal() <= lower_bound)
                                 existing_next->focal_handle = focal_list.push(existing_next);
+                            else
+                                existing_next->pending_handle = pending_list.push(existing_next);
                         }
                     }  // end update a node in closed list
-                    delete(next);  // not needed anymore -- we already generated it before
                 }  // end update an existing node
             }// end if case forthe move is legal
         }  // end for loop that generates successors
@@ -192,19 +275,25 @@ Path StateTimeAStar::run(const BasicGraph& G, const State& start,
             // of other agents.
             auto timesteps = rt.getConstrainedTimesteps(start.location);
             auto wait_cost = G.get_weight(start.location, start.location);
-            auto h = compute_h_value(G, start.location, 0, goal_location);
+            auto h = get_h_value<Value>(G, start.location, 0, start.orientation);
             for (int t : timesteps)
             {
                 State s(start.location, t, start.orientation);
-                auto node2 = new StateTimeAStarNode(s, t * wait_cost, h, root, 0);
+                auto node2 = nodes.create(s, t * wait_cost, h, root, 0);
+                node2->tie_breaker = get_tie_breaker();
                 num_generated++;
                 node2->open_handle = open_list.push(node2);
+                node2->pending_handle = pending_list.push(node2);
                 node2->in_openlist = true;
                 allNodes_table.insert(node2);
             }
             min_f_val = open_list.top()->getFVal();
             lower_bound = min_f_val;
-            open_list.top()->focal_handle = focal_list.push(open_list.top());
+            while (!pending_list.empty() && pending_list.top()->getFVal() <= lower_bound)
+            {
+                Node* n = pending_list.top(); pending_list.pop();
+                n->focal_handle = focal_list.push(n);
+            }
         }
         else
         {
@@ -214,10 +303,10 @@ Path StateTimeAStar::run(const BasicGraph& G, const State& start,
             {
                 double new_min_f_val = open_head->getFVal();
                 double new_lower_bound = std::max(lower_bound,  new_min_f_val);
-                for (StateTimeAStarNode* n : open_list)
+                while (!pending_list.empty() && pending_list.top()->getFVal() <= new_lower_bound)
                 {
-                    if (n->getFVal() > lower_bound && n->getFVal() <= new_lower_bound)
-                        n->focal_handle = focal_list.push(n);
+                    Node* n = pending_list.top(); pending_list.pop();
+                    n->focal_handle = focal_list.push(n);
                 }
                 min_f_val = new_min_f_val;
                 lower_bound = new_lower_bound;
@@ -230,11 +319,13 @@ Path StateTimeAStar::run(const BasicGraph& G, const State& start,
     releaseClosedListNodes();
     open_list.clear();
     focal_list.clear();
+    pending_list.clear();
     return Path();
 }
 
 
-void StateTimeAStar::findTrajectory(const BasicGraph& G,
+template<class QueuePolicy>
+void StateTimeAStarT<QueuePolicy>::findTrajectory(const BasicGraph& G,
                      const State& start,
                      const vector<pair<int, int> >& goal_locations,
                      const unordered_map<int, double>& travel_times,
@@ -246,8 +337,10 @@ void StateTimeAStar::findTrajectory(const BasicGraph& G,
     releaseClosedListNodes();
 
     // generate start and add it to the OPEN list
-    double h_val = compute_h_value(G, start.location, 0, goal_locations);
-    auto root = new StateTimeAStarNode(start, 0, h_val, nullptr, 0);
+    set_goal_sequence(G, goal_locations);
+    double h_val = get_h_value(G, start.location, 0, start.orientation);
+    auto root = nodes.create(start, 0, h_val, nullptr, 0);
+    root->tie_breaker = get_tie_breaker();
 
     num_generated++;
     root->open_handle = open_list.push(root);
@@ -266,6 +359,7 @@ void StateTimeAStar::findTrajectory(const BasicGraph& G,
 			curr->state.timestep >= goal_locations[curr->goal_id].second) // reach the goal location after its release time
         {
             curr->goal_id++;
+            allNodes_table.insert(curr); // under its new key
             if (curr->goal_id == (int) goal_locations.size())
             {
                 trajectory = updateTrajectory(curr);
@@ -281,23 +375,27 @@ void StateTimeAStar::findTrajectory(const BasicGraph& G,
         {
             travel_time += p->second;
         }
-        for (const auto& next_state: G.get_neighbors(curr->state))
+        for (const auto& neighbor: G.get_successors(curr->state))
         {
+            State next_state(neighbor.location, curr->state.timestep + 1, neighbor.orientation);
             if (curr->state.location == next_state.location && curr->state.orientation == next_state.orientation)
                 continue;
             // compute cost to next_id via curr node
-            double next_g_val = curr->g_val + G.get_weight(curr->state.location, next_state.location) * travel_time;
-            double next_h_val = compute_h_value(G, next_state.location, curr->goal_id, goal_locations);
+            double next_g_val = curr->g_val + neighbor.weight * travel_time;
+            double next_h_val = get_h_value(G, next_state.location, curr->goal_id, next_state.orientation);
             if (next_h_val >= INT_MAX) // This vertex cannot reach the goal vertex
                 continue;
 
-            // generate (maybe temporary) node
-            auto next = new StateTimeAStarNode(next_state, next_g_val, next_h_val, curr, 0);
+            // generate a temporary node for the lookup
+            Node temp(next_state, next_g_val, next_h_val, curr, 0);
+            auto next = &temp;
 
             // try to retrieve it from the hash table
-            auto existing = allNodes_table.find(next);
-            if (existing == allNodes_table.end())
+            auto existing = allNodes_table.find(next->get_key());
+            if (existing == nullptr)
             {
+                next = nodes.create(temp);
+                next->tie_breaker = get_tie_breaker();
                 next->open_handle = open_list.push(next);
                 next->in_openlist = true;
                 num_generated++;
@@ -306,35 +404,39 @@ void StateTimeAStar::findTrajectory(const BasicGraph& G,
             else
             {  // update existing node's if needed (only in the open_list)
 
-                if ((*existing)->getFVal() > next->getFVal())
+                if (existing->getFVal() > next->getFVal())
                 {
                     // update existing node
-                    (*existing)->g_val = next_g_val;
-                    (*existing)->h_val = next_h_val;
-                    (*existing)->goal_id = next->goal_id;
-                    (*existing)->parent = curr;
-                    (*existing)->depth = next->depth;
-                    if ((*existing)->in_openlist)
+                    existing->g_val = next_g_val;
+                    existing->h_val = next_h_val;
+                    existing->goal_id = next->goal_id;
+                    existing->parent = curr;
+                    existing->depth = next->depth;
+                    if (existing->in_openlist)
                     {
-                        open_list.increase((*existing)->open_handle);  // increase because f-val improved*/
+                        open_list.increase(existing->open_handle);  // increase because f-val improved*/
                     }
                     else // re-open
                     {
-                        (*existing)->open_handle = open_list.push(*existing);
-                        (*existing)->in_openlist = true;
+                        existing->open_handle = open_list.push(existing);
+                        existing->in_openlist = true;
                     }
                 }
-                delete(next);  // not needed anymore -- we already generated it before
-
             }  // end update an existing node
         }  // end for loop that generates successors
     }  // end while loop
 }
 
 
-inline void StateTimeAStar::releaseClosedListNodes()
+template<class QueuePolicy>
+inline void StateTimeAStarT<QueuePolicy>::releaseClosedListNodes()
 {
-    for (auto it : allNodes_table)
-        delete it;
     allNodes_table.clear();
-}
\ No newline at end of file
+    nodes.reset();
+}
+
+
+template class StateTimeAStarT<FibonacciHeapPolicy>;
+template class StateTimeAStarT<DaryHeapPolicy>;
+template class StateTimeAStarT<PairingHeapPolicy>;
+template class StateTimeAStarT<BucketQueuePolicy>;
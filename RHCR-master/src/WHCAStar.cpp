@@ -46,9 +46,12 @@ bool WHCAStar::run(const vector<State>& starts,
         bool succ = true;
         for (int i : priorities)
         {
-			rt.copy(initial_rt);
+			rt.setBase(initial_rt);
             rt.build(solution, initial_constraints, i);
+			path_planner.time_budget = low_level_deadline ? max(time_limit - runtime, 1e-6) : 0;
 			solution[i] = path_planner.run(G, starts[i], goal_locations[i], rt);
+			if (path_planner.partial_path && !keep_partial_path(solution[i]))
+				solution[i].clear();
             solution_cost += path_planner.path_cost;
             rt.clear();
             num_expanded += path_planner.num_expanded;
@@ -69,7 +72,7 @@ bool WHCAStar::run(const vector<State>& starts,
                 int start = starts[i].location;
                 for (const auto& goal : goal_locations[i])
                 {
-                    min_sum_of_costs += G.heuristics.at(goal.first)[start];
+                    min_sum_of_costs += G.heuristics.get(goal.first, start);
                     start = goal.first;
                 }
             }
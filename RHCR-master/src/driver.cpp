@@ -21,6 +21,7 @@ void set_parameters(BasicSystem& system, const boost::program_options::variables
 	system.k_robust = vm["robust"].as<int>();
 	system.hold_endpoints = vm["hold_endpoints"].as<bool>();
 	system.useDummyPaths = vm["dummy_paths"].as<bool>();
+	system.warm_start = vm["warm_start"].as<bool>();
 	if (vm.count("seed"))
 		system.seed = vm["seed"].as<int>();
 	else
@@ -29,24 +30,43 @@ void set_parameters(BasicSystem& system, const boost::program_options::variables
 }
 
 
+void set_heuristics(BasicGraph& G, const boost::program_options::variables_map& vm)
+{
+	G.num_threads = vm["threads"].as<int>();
+	G.oriented_heuristics = vm["oriented_heuristics"].as<bool>();
+	G.lazy_heuristics = vm["lazy_heuristics"].as<bool>();
+	G.heuristics_memory = vm["heuristics_memory"].as<double>();
+	G.prefetch_heuristics = vm["prefetch_heuristics"].as<bool>();
+}
+
+
 MAPFSolver* set_solver(const BasicGraph& G, const boost::program_options::variables_map& vm)
 {
 	string solver_name = vm["single_agent_solver"].as<string>();
-	SingleAgentSolver* path_planner;
-	MAPFSolver* mapf_solver;
-	if (solver_name == "ASTAR")
+	string queue = vm["queue"].as<string>();
+	// the bucket queue orders nodes by their integer f-values, so its top is only the minimum with integral costs
+	if (queue == "BUCKET" && !G.has_integral_weights())
 	{
-		path_planner = new StateTimeAStar();
+		cout << "The BUCKET queue needs integral edge weights; using FIBONACCI instead." << endl;
+		queue = "FIBONACCI";
 	}
-	else if (solver_name == "SIPP")
+	MAPFSolver* mapf_solver;
+	SingleAgentSolver* path_planner = create_single_agent_solver(solver_name, queue);
+	if (path_planner == nullptr)
 	{
-		path_planner = new SIPP();
+		cout << "Single-agent solver " << solver_name << " with queue " << queue
+			<< " does not exist!" << endl;
+		exit(-1);
 	}
-	else
+	if (!vm["record_queries"].as<string>().empty())
 	{
-		cout << "Single-agent solver " << solver_name << "does not exist!" << endl;
-		exit(-1);
+		static std::ofstream query_log(vm["record_queries"].as<string>());
+		path_planner->query_log = &query_log;
 	}
+	path_planner->random_tie_breaking = vm["random_tie_breaking"].as<bool>();
+	path_planner->rng.seed(vm.count("seed") ? vm["seed"].as<int>() : (int)time(0));
+	path_planner->collapse_horizon = vm["collapse_horizon"].as<bool>();
+	path_planner->expansion_budget = vm["low_level_expansions"].as<uint64_t>();
 
 	solver_name = vm["solver"].as<string>();
 	if (solver_name == "ECBS")
@@ -81,6 +101,7 @@ MAPFSolver* set_solver(const BasicGraph& G, const boost::program_options::variab
 		cout << "Solver " << solver_name << "does not exist!" << endl;
 		exit(-1);
 	}
+	mapf_solver->low_level_deadline = vm["low_level_deadline"].as<bool>();
 
 	if (vm["id"].as<bool>())
 	{
@@ -111,15 +132,39 @@ int main(int argc, char** argv)
 		("solver", po::value<string>()->default_value("PBS"), "solver (LRA, PBS, WHCA, ECBS)")
 		("id", po::value<bool>()->default_value(false), "independence detection")
 		("single_agent_solver", po::value<string>()->default_value("SIPP"), "single-agent solver (ASTAR, SIPP)")
+		("queue", po::value<string>()->default_value("FIBONACCI"),
+				"OPEN/FOCAL lists of the single-agent solver (FIBONACCI, DARY, PAIRING, BUCKET)")
+		("record_queries", po::value<string>()->default_value(""),
+				"record the single-agent queries to the given file (see bench/queue_benchmark.cpp)")
+		("random_tie_breaking", po::value<bool>()->default_value(false),
+				"break ties of the A* single-agent solver randomly (seeded by --seed) instead of by generation order")
 		("lazyP", po::value<bool>()->default_value(false), "use lazy priority")
 		("simulation_time", po::value<int>()->default_value(5000), "run simulation")
 		("simulation_window", po::value<int>()->default_value(5), "call the planner every simulation_window timesteps")
 		("travel_time_window", po::value<int>()->default_value(0), "consider the traffic jams within the given window")
 		("planning_window", po::value<int>()->default_value(INT_MAX / 2),
 		        "the planner outputs plans with first planning_window timesteps collision-free")
+		("collapse_horizon", po::value<bool>()->default_value(false),
+				"complete the single-agent paths beyond the planning window from the heuristic tables without search")
+		("warm_start", po::value<bool>()->default_value(false),
+				"warm-start the single-agent searches of PBS and ECBS from the previous plans of the agents")
+		("low_level_expansions", po::value<uint64_t>()->default_value(0),
+				"stop a single-agent search once it expands that many nodes and return its partial path, "
+				"which is kept only if it covers the simulation window (0: no budget)")
+		("low_level_deadline", po::value<bool>()->default_value(false),
+				"stop a single-agent search of PBS, ECBS or WHCA* at the cutoff time and return its partial path, "
+				"which is kept only if it covers the simulation window")
 		("potential_function", po::value<string>()->default_value("NONE"), "potential function (NONE, SOC, IC)")
 		("potential_threshold", po::value<double>()->default_value(0), "potential threshold")
 		("rotation", po::value<bool>()->default_value(false), "consider rotation")
+		("oriented_heuristics", po::value<bool>()->default_value(false),
+				"keep heuristics per (location, orientation) when considering rotation")
+		("lazy_heuristics", po::value<bool>()->default_value(false),
+				"compute heuristic tables on first use instead of in preprocessing")
+		("heuristics_memory", po::value<double>()->default_value(1024),
+				"memory budget (MB) of lazily computed heuristic tables")
+		("prefetch_heuristics", po::value<bool>()->default_value(false),
+				"compute the heuristic tables of upcoming tasks on a background thread (with lazy_heuristics)")
 		("robust", po::value<int>()->default_value(0), "k-robust (for now, only work for PBS)")
 		("CAT", po::value<bool>()->default_value(false), "use conflict-avoidance table")
 		// ("PG", po::value<bool>()->default_value(false),
@@ -131,6 +176,7 @@ int main(int argc, char** argv)
 		("prioritize_start", po::value<bool>()->default_value(true), "Prioritize waiting at start locations")
 		("suboptimal_bound", po::value<double>()->default_value(1), "Suboptimal bound for ECBS")
 		("log", po::value<bool>()->default_value(false), "save the search trees (and the priority trees)")
+		("threads", po::value<int>()->default_value(1), "number of threads for computing heuristic tables")
 		;
 	clock_t start_time = clock();
 	po::variables_map vm;
@@ -178,6 +224,7 @@ int main(int argc, char** argv)
 	if (vm["scenario"].as<string>() == "KIVA")
 	{
 		KivaGrid G;
+		set_heuristics(G, vm);
 		if (!G.load_map(vm["map"].as<std::string>()))
 			return -1;
 		MAPFSolver* solver = set_solver(G, vm);
@@ -190,6 +237,7 @@ int main(int argc, char** argv)
 	else if (vm["scenario"].as<string>() == "SORTING")
 	{
 		 SortingGrid G;
+		 set_heuristics(G, vm);
 		 if (!G.load_map(vm["map"].as<std::string>()))
 			 return -1;
 		 MAPFSolver* solver = set_solver(G, vm);
@@ -204,6 +252,7 @@ int main(int argc, char** argv)
 	else if (vm["scenario"].as<string>() == "ONLINE")
 	{
 		OnlineGrid G;
+		set_heuristics(G, vm);
 		if (!G.load_map(vm["map"].as<std::string>()))
 			return -1;
 		MAPFSolver* solver = set_solver(G, vm);
@@ -218,6 +267,7 @@ int main(int argc, char** argv)
 	else if (vm["scenario"].as<string>() == "BEE")
 	{
 		BeeGraph G;
+		set_heuristics(G, vm);
 		if (!G.load_map(vm["map"].as<std::string>()))
 			return -1;
 		MAPFSolver* solver = set_solver(G, vm);